@@ -0,0 +1,678 @@
+/* Micro-benchmarks of the hot paths of the simulation.
+ * Doesn't open a window; prints results as JSON (default) or CSV to stdout.
+ *
+ * Options:
+ *   --sizes 1000,10000,...    particle counts (default: 1000,10000,100000,1000000)
+ *   --threads 1,2,4,...       thread counts for the parallel benchmarks (default: powers of two up to the core count)
+ *   --reps N                  repetitions of every benchmark (default: 7)
+ *   --max-update-size N       largest particle count the update benchmarks run at (default: 100000)
+ *   --ensemble-size N         simulations in the ensemble benchmark (default: 32)
+ *   --huge-pages none|transparent|explicit   memory for the particles (default: none)
+ *   --cell-order rows|morton  order of the grid cells (default: rows)
+ *   --format json|csv
+ *
+ * memory_growth is how much the resident memory of the whole process grew per update step
+ * after a few steps to warm up; anything but about 0 means something piles up, and is also printed as a warning.
+ */
+
+#include <chrono>
+#include <cmath>
+#include <random>
+#include <string>
+#include <vector>
+#include <iostream>
+#include <fstream>
+#include <algorithm>
+#include <functional>
+#include <thread>
+#include <optional>
+
+#include "Simulation.hpp"
+#include "ParticleGrid.hpp"
+#include "Recipe.hpp"
+#include "RuleTable.hpp"
+#include "Ensemble.hpp"
+#include "Publisher.hpp"
+#include "ClusterAnalysis.hpp"
+#include "strutil.hpp"
+
+#if __has_include(<omp.h>)
+	#define OMP_PRESENT
+	#include <omp.h>
+#endif
+
+#if __has_include(<unistd.h>)
+	#define UNISTD_PRESENT
+	#include <unistd.h>
+#endif
+
+using namespace std::chrono;
+
+namespace {
+	// same particle density as the example recipes (3000 particles on 800x600)
+	const float area_per_particle = 160;
+	const float interaction_radius = 80;
+	// what Simulation picks for the rules below
+	const float grid_cell_size = interaction_radius / 2;
+	const std::vector<core::Color> colors = { core::Color::Yellow, core::Color::Green, core::Color::Cyan };
+
+	enum class Distribution { Uniform, Clustered };
+
+	// keeps the compiler from optimizing away the benchmarked work
+	volatile double sink;
+
+	struct Options {
+		std::vector<int> sizes = { 1000, 10000, 100000, 1000000 };
+		std::vector<int> threads;
+		int reps = 7;
+		int max_update_size = 100000;
+		int ensemble_size = 32;
+		ParticleGrid::CellOrder cell_order = ParticleGrid::CellOrder::Rows;
+		bool csv = false;
+	};
+
+	struct Result {
+		std::string name;
+		std::string distribution;
+		int particles;
+		int threads;
+		int reps;
+		// of the values below: ns/op, or relative for errors and bytes/step for memory growth
+		std::string unit;
+		double min;
+		double p10;
+		double median;
+		double p90;
+		double max;
+	};
+
+	std::string to_string(Distribution distribution) {
+		if(distribution == Distribution::Uniform) return "uniform";
+		return "clustered";
+	}
+
+	core::Vector2i board_for(int particle_count) {
+		int side = std::ceil(std::sqrt(particle_count * area_per_particle));
+		return { side, side };
+	}
+
+	std::vector<Particle> generate_particles(int count, core::Vector2i board, Distribution distribution, unsigned seed) {
+		std::default_random_engine eng(seed);
+		auto x_dist = std::uniform_real_distribution<float>(0, board.x);
+		auto y_dist = std::uniform_real_distribution<float>(0, board.y);
+		auto color_dist = std::uniform_int_distribution<std::size_t>(0, colors.size() - 1);
+
+		// clusters have a few hundred particles each, like the cells in `mitosis.txt`
+		int cluster_count = std::max(1, count / 300);
+		std::vector<core::Vector2f> centers;
+		for(int i=0; i<cluster_count; ++i) centers.push_back({x_dist(eng), y_dist(eng)});
+		auto center_dist = std::uniform_int_distribution<int>(0, cluster_count - 1);
+		auto spread_dist = std::normal_distribution<float>(0, interaction_radius / 2);
+
+		std::vector<Particle> particles;
+		particles.reserve(count);
+
+		while(static_cast<int>(particles.size()) < count) {
+			core::Vector2f position;
+			if(distribution == Distribution::Uniform) {
+				position = { x_dist(eng), y_dist(eng) };
+			} else {
+				auto center = centers[center_dist(eng)];
+				position = { center.x + spread_dist(eng), center.y + spread_dist(eng) };
+			}
+
+			if(position.x <= 0 || position.y <= 0 || position.x >= board.x || position.y >= board.y) continue;
+			particles.push_back(Particle(position, {0, 0}, colors[color_dist(eng)]));
+		}
+
+		return particles;
+	}
+
+	Recipe make_recipe(core::Vector2i board) {
+		Recipe recipe;
+		recipe.add_step(Recipe::Window { board.x, board.y });
+		recipe.add_step(Recipe::Friction { 0.2 });
+
+		// the rules of `mitosis.txt`
+		recipe.add_step(Rule { core::Color::Yellow, core::Color::Green, 5, 80, -0.05 });
+		recipe.add_step(Rule { core::Color::Green, core::Color::Yellow, 5, 80, -0.05 });
+		recipe.add_step(Rule { core::Color::Cyan, core::Color::Yellow, 5, 80, -0.03 });
+		recipe.add_step(Rule { core::Color::Cyan, core::Color::Green, 5, 80, -0.03 });
+		recipe.add_step(Rule { core::Color::Yellow, core::Color::Cyan, 5, 80, 0.02 });
+		recipe.add_step(Rule { core::Color::Green, core::Color::Cyan, 5, 80, 0.02 });
+		recipe.add_step(Rule { core::Color::Yellow, core::Color::Yellow, 5, 80, 0.01 });
+		recipe.add_step(Rule { core::Color::Green, core::Color::Green, 5, 80, 0.01 });
+		recipe.add_step(Rule { core::Color::Cyan, core::Color::Cyan, 5, 2, 0 });
+		return recipe;
+	}
+
+	// long rules between colours and very short ones within a colour, so that the short ones
+	// get subcells of their own (see ParticleGrid::set_levels())
+	Recipe make_mixed_recipe(core::Vector2i board) {
+		Recipe recipe;
+		recipe.add_step(Recipe::Window { board.x, board.y });
+		recipe.add_step(Recipe::Friction { 0.2 });
+
+		for(const auto& color1 : colors) {
+			for(const auto& color2 : colors) {
+				if(color1 == color2) recipe.add_step(Rule { color1, color2, 2, 4, -0.3 });
+				else recipe.add_step(Rule { color1, color2, 20, interaction_radius, -0.02 });
+			}
+		}
+		return recipe;
+	}
+
+	std::string to_string(ParticleGrid::CellIndex cell_index) {
+		if(cell_index == ParticleGrid::CellIndex::Dense) return "dense";
+		return "sparse";
+	}
+
+	ParticleGrid make_grid(
+			const std::vector<Particle>& particles,
+			core::Vector2i board,
+			ParticleGrid::CellIndex cell_index,
+			ParticleGrid::CellOrder cell_order)
+	{
+		ParticleGrid grid(board, grid_cell_size, cell_index, cell_order);
+		for(const auto& particle : particles) grid.append(particle);
+		grid.sort();
+		grid.spread_over_threads();
+		return grid;
+	}
+
+	double percentile(const std::vector<double>& sorted, double p) {
+		double position = p * (sorted.size() - 1);
+		auto lower = static_cast<std::size_t>(std::floor(position));
+		auto upper = static_cast<std::size_t>(std::ceil(position));
+		double fraction = position - lower;
+		return sorted[lower] * (1 - fraction) + sorted[upper] * fraction;
+	}
+
+	// `run` does one repetition and returns the time it took per operation in nanoseconds
+	Result measure(
+			const std::string& name,
+			Distribution distribution,
+			int particles,
+			int threads,
+			int reps,
+			const std::function<double()>& run)
+	{
+		std::vector<double> samples;
+		for(int i=0; i<reps; ++i) samples.push_back(run());
+		std::sort(samples.begin(), samples.end());
+
+		return Result {
+			name, to_string(distribution), particles, threads, reps, "ns/op",
+			samples.front(),
+			percentile(samples, 0.1),
+			percentile(samples, 0.5),
+			percentile(samples, 0.9),
+			samples.back()
+		};
+	}
+
+	template<typename Function>
+	double time_ns(Function function) {
+		auto start = steady_clock::now();
+		function();
+		return duration_cast<nanoseconds>(steady_clock::now() - start).count();
+	}
+
+	void set_threads(int threads) {
+		#ifdef OMP_PRESENT
+			omp_set_num_threads(threads);
+		#else
+			(void)threads;
+		#endif
+	}
+
+	void bench_grid(
+			const Options& options,
+			Distribution distribution,
+			ParticleGrid::CellIndex cell_index,
+			int size,
+			std::vector<Result>& results)
+	{
+		auto board = board_for(size);
+		auto particles = generate_particles(size, board, distribution, size);
+		auto grid = make_grid(particles, board, cell_index, options.cell_order);
+		auto suffix = "_" + to_string(cell_index);
+
+		// positions after one step; particles move at most a few pixels per frame
+		auto moved = grid.get_particles();
+		std::default_random_engine eng(size);
+		auto jitter = std::uniform_real_distribution<float>(-2, 2);
+		for(auto& particle : moved) {
+			particle.position.x = std::clamp(particle.position.x + jitter(eng), 0.f, board.x - 1.f);
+			particle.position.y = std::clamp(particle.position.y + jitter(eng), 0.f, board.y - 1.f);
+		}
+
+		results.push_back(measure("grid_sort" + suffix, distribution, size, 1, options.reps, [&]() {
+			grid.get_mut_particles() = moved;
+			return time_ns([&]() { grid.sort(); });
+		}));
+
+		const int query_count = std::min(size, 10000);
+		results.push_back(measure("grid_get_ranges_in" + suffix, distribution, size, 1, options.reps, [&]() {
+			const auto& sorted = grid.get_particles();
+			std::size_t found = 0;
+			double ns = time_ns([&]() {
+				for(int i=0; i<query_count; ++i) {
+					auto position = sorted[(i * 7919) % sorted.size()].position;
+					auto area = core::FloatRect(
+							position.x - interaction_radius,
+							position.y - interaction_radius,
+							interaction_radius * 2,
+							interaction_radius * 2);
+					found += grid.get_ranges_in(area).size();
+				}
+			});
+			sink = found;
+			return ns / query_count;
+		}));
+
+		const int insert_count = 100;
+		auto inserted = generate_particles(insert_count, board, distribution, size + 1);
+		results.push_back(measure("grid_insert" + suffix, distribution, size, 1, options.reps, [&]() {
+			auto fresh = grid;
+			return time_ns([&]() {
+				for(const auto& particle : inserted) fresh.insert(particle);
+			}) / insert_count;
+		}));
+	}
+
+	void bench_update(const Options& options, Distribution distribution, int size, std::vector<Result>& results) {
+		auto board = board_for(size);
+		auto particles = generate_particles(size, board, distribution, size);
+
+		for(int threads : options.threads) {
+			Simulation simulation(make_recipe(board), threads, false);
+			simulation.add_particles(particles);
+			simulation.set_cell_order(options.cell_order);
+			set_threads(threads);
+
+			// let the particles leave their synthetic starting positions
+			simulation.update();
+
+			results.push_back(measure("update", distribution, size, threads, options.reps, [&]() {
+				return time_ns([&]() { simulation.update(); });
+			}));
+		}
+	}
+
+	// the same mixed-radius simulation with the short rules on subcells and on whole cells
+	void bench_levels(const Options& options, Distribution distribution, int size, std::vector<Result>& results) {
+		auto board = board_for(size);
+		int threads = options.threads.back();
+		set_threads(threads);
+
+		Simulation simulation(make_mixed_recipe(board), threads, false);
+		simulation.add_particles(generate_particles(size, board, distribution, size));
+		simulation.set_cell_order(options.cell_order);
+		simulation.update();
+
+		// whatever make_grid() allows first, then none
+		for(int levels : { ParticleGrid::max_levels, 0 }) {
+			auto with_levels = simulation;
+			with_levels.set_max_grid_levels(levels);
+			auto name = "levels_" + std::to_string(with_levels.get_particles().get_levels()) + "_update";
+
+			results.push_back(measure(name, distribution, size, threads, options.reps, [&]() {
+				auto copy = with_levels;
+				return time_ns([&]() { copy.update(); });
+			}));
+		}
+	}
+
+	// the resident memory of the whole process; 0 where /proc/self/statm isn't there
+	double resident_bytes() {
+		std::ifstream statm("/proc/self/statm");
+		double size = 0;
+		double resident = 0;
+		if(!(statm >> size >> resident)) return 0;
+
+		double page_size = 4096;
+		#ifdef UNISTD_PRESENT
+			page_size = sysconf(_SC_PAGESIZE);
+		#endif
+		return resident * page_size;
+	}
+
+	// per-step scratch memory (like the ranges of the neighbour queries) has to be reused, not piled up
+	void bench_memory(const Options& options, Distribution distribution, int size, std::vector<Result>& results) {
+		auto board = board_for(size);
+		int threads = options.threads.back();
+		set_threads(threads);
+
+		Simulation simulation(make_recipe(board), threads, false);
+		simulation.add_particles(generate_particles(size, board, distribution, size));
+		simulation.set_cell_order(options.cell_order);
+		simulation.update(3);
+
+		double before = resident_bytes();
+		if(before == 0) return;
+		const int steps = 10;
+		simulation.update(steps);
+		double growth = std::max(resident_bytes() - before, 0.0) / steps;
+
+		results.push_back(Result {
+			"memory_growth", to_string(distribution), size, threads, steps, "bytes/step",
+			growth, growth, growth, growth, growth
+		});
+		if(growth * steps > 1024 * 1024) {
+			std::cerr << "warning: resident memory grew by " << growth << " bytes per step at "
+			          << size << " " << to_string(distribution) << " particles\n";
+		}
+	}
+
+	// the far field against exact steps from the same state: how long a step takes,
+	// and how far the velocities after a step end up from the exact ones, as the root mean square
+	// of the difference relative to the root mean square of the exact velocities
+	void bench_far_field(const Options& options, Distribution distribution, int size, std::vector<Result>& results) {
+		auto board = board_for(size);
+		int threads = options.threads.back();
+		set_threads(threads);
+
+		Simulation exact(make_recipe(board), threads, false);
+		exact.add_particles(generate_particles(size, board, distribution, size));
+		exact.set_cell_order(options.cell_order);
+		// the particles have to get moving before there's anything to compare
+		exact.update(10);
+
+		auto exact_step = exact;
+		exact_step.update();
+		const auto& exact_particles = exact_step.get_particles().get_particles();
+		const auto& exact_indices = exact_step.get_particles().get_indices_by_id();
+
+		for(float fraction : { 0.75f, 0.5f, 0.25f }) {
+			auto approximate = exact;
+			approximate.enable_far_field(fraction);
+			auto name = "far_field_" + std::to_string(static_cast<int>(fraction * 100));
+
+			results.push_back(measure(name + "_update", distribution, size, threads, options.reps, [&]() {
+				auto simulation = approximate;
+				return time_ns([&]() { simulation.update(); });
+			}));
+
+			approximate.update();
+			const auto& particles = approximate.get_particles().get_particles();
+			const auto& indices = approximate.get_particles().get_indices_by_id();
+			double difference = 0;
+			double magnitude = 0;
+			for(std::size_t id=0; id<exact_indices.size(); ++id) {
+				if(exact_indices[id] == ParticleGrid::no_index) continue;
+				auto exact_velocity = exact_particles[exact_indices[id]].velocity;
+				auto velocity = particles[indices[id]].velocity;
+				difference += std::pow(velocity.x - exact_velocity.x, 2) + std::pow(velocity.y - exact_velocity.y, 2);
+				magnitude += std::pow(exact_velocity.x, 2) + std::pow(exact_velocity.y, 2);
+			}
+
+			double error = magnitude > 0 ? std::sqrt(difference / magnitude) : 0;
+			results.push_back(Result {
+				name + "_error", to_string(distribution), size, threads, 1, "relative",
+				error, error, error, error, error
+			});
+		}
+	}
+
+	// many `mitosis.txt`-sized simulations, one per thread at a time;
+	// compare with `update` at the same size to see what batching small worlds gains
+	void bench_ensemble(const Options& options, std::vector<Result>& results) {
+		const int size = 3000;
+		auto board = board_for(size);
+		auto recipe = make_recipe(board);
+		for(const auto& color : colors) recipe.add_step(Recipe::Particles { color, size / static_cast<int>(colors.size()) });
+
+		for(int threads : options.threads) {
+			set_threads(threads);
+			Ensemble ensemble(recipe, options.ensemble_size, 0, false);
+			ensemble.update(1);
+
+			// per step of a single simulation
+			results.push_back(measure("ensemble_update", Distribution::Uniform, size, threads, options.reps, [&]() {
+				return time_ns([&]() { ensemble.update(1); }) / options.ensemble_size;
+			}));
+		}
+	}
+
+	// one pass of `--clusters` with the default distance
+	void bench_clusters(const Options& options, Distribution distribution, int size, std::vector<Result>& results) {
+		auto board = board_for(size);
+		auto grid = make_grid(generate_particles(size, board, distribution, size), board, ParticleGrid::CellIndex::Dense, options.cell_order);
+		ClusterAnalysis analysis(make_recipe(board), 10);
+
+		for(int threads : options.threads) {
+			set_threads(threads);
+			results.push_back(measure("clusters", distribution, size, threads, options.reps, [&]() {
+				return time_ns([&]() { analysis.analyze(grid); });
+			}));
+		}
+	}
+
+	// what `--publish` adds to every frame
+	void bench_publish(const Options& options, int size, std::vector<Result>& results) {
+		auto board = board_for(size);
+		auto generated = generate_particles(size, board, Distribution::Uniform, size);
+		auto particles = ParticleGrid::ParticleVector(generated.begin(), generated.end());
+
+		Publisher publisher("/somelife_bench_" + std::to_string(size), board, size);
+		if(!publisher.get_errors().empty()) {
+			std::cerr << publisher.get_errors();
+			return;
+		}
+
+		results.push_back(measure("publish", Distribution::Uniform, size, 1, options.reps, [&]() {
+			return time_ns([&]() { publisher.publish(particles); });
+		}));
+	}
+
+	// the same work per pair as Simulation's force loop on a rule table, and as the loop that goes
+	// through the rules one by one when no table fits them (more than max_species colours,
+	// several rules for a pair of colours)
+	void bench_kernel(const Options& options, std::vector<Result>& results) {
+		auto rule = Rule { core::Color::Yellow, core::Color::Green, 5, 80, -0.05 };
+		auto kernel = rule_table::make_kernel(rule);
+
+		const int call_count = 1000000;
+		std::vector<core::Vector2f> others;
+		std::vector<Particle> other_particles;
+		std::default_random_engine eng(0);
+		auto offset = std::uniform_real_distribution<float>(-interaction_radius, interaction_radius);
+		// force() is only ever asked about distances in reach
+		auto distance = std::uniform_real_distribution<float>(0.01, kernel.reach);
+		std::vector<float> distances;
+		for(int i=0; i<1024; ++i) {
+			others.push_back({offset(eng), offset(eng)});
+			other_particles.push_back(Particle(others.back(), {0, 0}, core::Color::Green));
+			distances.push_back(distance(eng));
+		}
+
+		results.push_back(measure("kernel_force", Distribution::Uniform, call_count, 1, options.reps, [&]() {
+			float sum = 0;
+			double ns = time_ns([&]() {
+				for(int i=0; i<call_count; ++i) sum += rule_table::force(kernel, distances[i % distances.size()]);
+			});
+			sink = sum;
+			return ns / call_count;
+		}));
+
+		// the reach check, square root and accumulation around it, for particles in and out of reach
+		results.push_back(measure("kernel_pair", Distribution::Uniform, call_count, 1, options.reps, [&]() {
+			core::Vector2f acceleration;
+			double ns = time_ns([&]() {
+				for(int i=0; i<call_count; ++i) {
+					auto other = others[i % others.size()];
+					float distance_squared = other.x*other.x + other.y*other.y;
+					if(distance_squared > kernel.second_cut_squared || distance_squared == 0) continue;
+
+					float distance = std::sqrt(distance_squared);
+					float force = rule_table::force(kernel, distance) / distance;
+					acceleration.x += force * other.x;
+					acceleration.y += force * other.y;
+				}
+			});
+			sink = acceleration.x;
+			return ns / call_count;
+		}));
+
+		// the rule by rule loop (Simulation::move_particles_with(std::monostate))
+		auto board = board_for(1000);
+		Simulation simulation(make_recipe(board), 1, false);
+
+		results.push_back(measure("calculate_force", Distribution::Uniform, call_count, 1, options.reps, [&]() {
+			float sum = 0;
+			double ns = time_ns([&]() {
+				for(int i=0; i<call_count; ++i) sum += simulation.calculate_force(rule, distances[i % distances.size()]);
+			});
+			sink = sum;
+			return ns / call_count;
+		}));
+
+		results.push_back(measure("execute_rule", Distribution::Uniform, call_count, 1, options.reps, [&]() {
+			auto particle = Particle({0, 0}, {0, 0}, core::Color::Yellow);
+			double ns = time_ns([&]() {
+				for(int i=0; i<call_count; ++i) simulation.execute_rule(rule, particle, other_particles[i % other_particles.size()]);
+			});
+			sink = particle.velocity.x;
+			return ns / call_count;
+		}));
+	}
+
+	std::optional<std::vector<int>> parse_list(std::string_view str) {
+		std::vector<int> values;
+		while(!str.empty()) {
+			auto comma = str.find(',');
+			auto maybe_value = strutil::stoi_positive(str.substr(0, comma));
+			if(!maybe_value.has_value()) return std::nullopt;
+			values.push_back(maybe_value.value());
+			if(comma == std::string_view::npos) break;
+			str.remove_prefix(comma + 1);
+		}
+		if(values.empty()) return std::nullopt;
+		return values;
+	}
+
+	std::optional<Options> parse_options(int argc, const char* argv[]) {
+		Options options;
+
+		int max_threads = std::thread::hardware_concurrency();
+		#ifdef OMP_PRESENT
+			max_threads = omp_get_max_threads();
+		#endif
+		for(int threads = 1; threads < max_threads; threads *= 2) options.threads.push_back(threads);
+		options.threads.push_back(std::max(max_threads, 1));
+
+		for(int i=1; i<argc; ++i) {
+			std::string_view option = argv[i];
+			if(i + 1 >= argc) {
+				std::cerr << "Option `" << option << "` requires an argument\n";
+				return std::nullopt;
+			}
+			std::string_view value = argv[++i];
+
+			if(option == "--huge-pages") {
+				if(value == "transparent") particle_memory::set_huge_pages(particle_memory::HugePages::Transparent);
+				else if(value == "explicit") particle_memory::set_huge_pages(particle_memory::HugePages::Explicit);
+				else if(value != "none") {
+					std::cerr << "`--huge-pages` must be `none`, `transparent` or `explicit`\n";
+					return std::nullopt;
+				}
+				continue;
+			}
+
+			if(option == "--cell-order") {
+				if(value != "rows" && value != "morton") {
+					std::cerr << "`--cell-order` must be `rows` or `morton`\n";
+					return std::nullopt;
+				}
+				if(value == "morton") options.cell_order = ParticleGrid::CellOrder::Morton;
+				continue;
+			}
+
+			if(option == "--format") {
+				if(value != "json" && value != "csv") {
+					std::cerr << "`--format` must be `json` or `csv`\n";
+					return std::nullopt;
+				}
+				options.csv = value == "csv";
+				continue;
+			}
+
+			auto maybe_list = parse_list(value);
+			if(!maybe_list.has_value()) {
+				std::cerr << "`" << value << "` is not a list of positive integer numbers\n";
+				return std::nullopt;
+			}
+			auto list = maybe_list.value();
+
+			if(option == "--sizes") options.sizes = list;
+			else if(option == "--threads") options.threads = list;
+			else if(option == "--reps") options.reps = list.front();
+			else if(option == "--max-update-size") options.max_update_size = list.front();
+			else if(option == "--ensemble-size") options.ensemble_size = list.front();
+			else {
+				std::cerr << "Unknown option `" << option << "`\n";
+				return std::nullopt;
+			}
+		}
+
+		return options;
+	}
+
+	void print_csv(const std::vector<Result>& results) {
+		std::cout << "name,distribution,particles,threads,reps,unit,min,p10,median,p90,max\n";
+		for(const auto& result : results) {
+			std::cout
+				<< result.name << "," << result.distribution << "," << result.particles << ","
+				<< result.threads << "," << result.reps << "," << result.unit << "," << result.min << "," << result.p10 << ","
+				<< result.median << "," << result.p90 << "," << result.max << "\n";
+		}
+	}
+
+	void print_json(const std::vector<Result>& results) {
+		std::cout << "[\n";
+		for(std::size_t i=0; i<results.size(); ++i) {
+			const auto& result = results[i];
+			std::cout
+				<< "  {\"name\": \"" << result.name << "\", \"distribution\": \"" << result.distribution
+				<< "\", \"particles\": " << result.particles << ", \"threads\": " << result.threads
+				<< ", \"reps\": " << result.reps << ", \"unit\": \"" << result.unit << "\", \"min\": " << result.min
+				<< ", \"p10\": " << result.p10 << ", \"median\": " << result.median
+				<< ", \"p90\": " << result.p90 << ", \"max\": " << result.max << "}"
+				<< (i + 1 < results.size() ? ",\n" : "\n");
+		}
+		std::cout << "]\n";
+	}
+}
+
+int main(int argc, const char* argv[]) {
+	auto maybe_options = parse_options(argc, argv);
+	if(!maybe_options.has_value()) return EXIT_FAILURE;
+	auto options = maybe_options.value();
+
+	std::vector<Result> results;
+
+	bench_kernel(options, results);
+	bench_ensemble(options, results);
+
+	for(auto distribution : { Distribution::Uniform, Distribution::Clustered }) {
+		for(int size : options.sizes) {
+			std::cerr << "benchmarking " << to_string(distribution) << " " << size << "...\n";
+			bench_grid(options, distribution, ParticleGrid::CellIndex::Dense, size, results);
+			bench_grid(options, distribution, ParticleGrid::CellIndex::Sparse, size, results);
+			if(size <= options.max_update_size) {
+				bench_update(options, distribution, size, results);
+				bench_far_field(options, distribution, size, results);
+				bench_levels(options, distribution, size, results);
+				bench_memory(options, distribution, size, results);
+			}
+			if(distribution == Distribution::Uniform) bench_publish(options, size, results);
+			bench_clusters(options, distribution, size, results);
+		}
+	}
+
+	if(options.csv) print_csv(results);
+	else print_json(results);
+
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,57 @@
+#include "AllocationCounter.hpp"
+#include <atomic>
+#include <new>
+#include <cstdlib>
+
+namespace allocation_counter {
+	namespace {
+		std::atomic<std::uint64_t> allocations(0);
+	}
+
+	bool enabled() {
+		#ifdef NDEBUG
+			return false;
+		#else
+			return true;
+		#endif
+	}
+
+	std::uint64_t count() {
+		return allocations.load(std::memory_order_relaxed);
+	}
+}
+
+#ifndef NDEBUG
+
+namespace {
+	void* counted_malloc(std::size_t size) {
+		allocation_counter::allocations.fetch_add(1, std::memory_order_relaxed);
+		if(void* memory = std::malloc(size == 0 ? 1 : size)) return memory;
+		throw std::bad_alloc();
+	}
+
+	void* counted_aligned_alloc(std::size_t size, std::align_val_t alignment) {
+		allocation_counter::allocations.fetch_add(1, std::memory_order_relaxed);
+		auto align = static_cast<std::size_t>(alignment);
+		// aligned_alloc wants the size to be a multiple of the alignment
+		auto rounded = (size + align - 1) / align * align;
+		if(void* memory = std::aligned_alloc(align, rounded == 0 ? align : rounded)) return memory;
+		throw std::bad_alloc();
+	}
+}
+
+void* operator new(std::size_t size) { return counted_malloc(size); }
+void* operator new[](std::size_t size) { return counted_malloc(size); }
+void* operator new(std::size_t size, std::align_val_t alignment) { return counted_aligned_alloc(size, alignment); }
+void* operator new[](std::size_t size, std::align_val_t alignment) { return counted_aligned_alloc(size, alignment); }
+
+void operator delete(void* pointer) noexcept { std::free(pointer); }
+void operator delete[](void* pointer) noexcept { std::free(pointer); }
+void operator delete(void* pointer, std::size_t) noexcept { std::free(pointer); }
+void operator delete[](void* pointer, std::size_t) noexcept { std::free(pointer); }
+void operator delete(void* pointer, std::align_val_t) noexcept { std::free(pointer); }
+void operator delete[](void* pointer, std::align_val_t) noexcept { std::free(pointer); }
+void operator delete(void* pointer, std::size_t, std::align_val_t) noexcept { std::free(pointer); }
+void operator delete[](void* pointer, std::size_t, std::align_val_t) noexcept { std::free(pointer); }
+
+#endif
@@ -0,0 +1,14 @@
+#pragma once
+
+#include <cstdint>
+
+/* Counts heap allocations of the whole program, to check that frames don't allocate.
+ * Only in debug builds (without NDEBUG), where the global operator new is replaced;
+ * in release builds the count is always 0.
+ */
+
+namespace allocation_counter {
+	bool enabled();
+	// allocations since the program started
+	std::uint64_t count();
+}
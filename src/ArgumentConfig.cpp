@@ -13,6 +13,58 @@ std::string_view ArgumentConfig::get_recording_path() const {
 	return recording_path;
 }
 
+std::string_view ArgumentConfig::get_trace_path() const {
+	return trace_path;
+}
+
+std::string_view ArgumentConfig::get_sweep_path() const {
+	return sweep_path;
+}
+
+std::string_view ArgumentConfig::get_export_path() const {
+	return export_path;
+}
+
+bool ArgumentConfig::get_export_raw() const {
+	return export_raw;
+}
+
+std::string_view ArgumentConfig::get_publish_name() const {
+	return publish_name;
+}
+
+std::string_view ArgumentConfig::get_clusters_prefix() const {
+	return clusters_prefix;
+}
+
+int ArgumentConfig::get_cluster_interval() const {
+	return cluster_interval;
+}
+
+float ArgumentConfig::get_cluster_distance() const {
+	return cluster_distance;
+}
+
+float ArgumentConfig::get_sleep_speed() const {
+	return sleep_speed;
+}
+
+int ArgumentConfig::get_sleep_after() const {
+	return sleep_after;
+}
+
+float ArgumentConfig::get_far_field() const {
+	return far_field;
+}
+
+std::string_view ArgumentConfig::get_load_prefix() const {
+	return load_prefix;
+}
+
+bool ArgumentConfig::get_record_in_id_order() const {
+	return record_in_id_order;
+}
+
 ArgumentConfig::RecordingState ArgumentConfig::get_recording_state() const {
 	return recording_state;
 }
@@ -21,6 +73,10 @@ int ArgumentConfig::get_framerate() const {
 	return framerate;
 }
 
+int ArgumentConfig::get_steps_per_frame() const {
+	return steps_per_frame;
+}
+
 std::string_view ArgumentConfig::get_errors() const {
 	return errors;
 }
@@ -29,7 +85,20 @@ ArgumentConfig::ArgumentConfig(int argc, const char** argv):
 	recording_state(RecordingState::None),
 	recipe_path(""),
 	recording_path(""),
+	trace_path(""),
+	sweep_path(""),
+	export_path(""),
+	export_raw(false),
+	publish_name(""),
+	clusters_prefix(""),
+	cluster_interval(60),
+	cluster_distance(10),
+	sleep_speed(0),
+	sleep_after(30),
+	far_field(0),
+	record_in_id_order(false),
 	framerate(-1),
+	steps_per_frame(1),
 	errors("")
 {
 	std::vector<std::string_view> args;
@@ -41,6 +110,20 @@ ArgumentConfig::ArgumentConfig(int argc, const char** argv):
 	auto record_result = read_option(args, "record");
 	auto replay_result = read_option(args, "replay");
 	auto framerate_result = read_option(args, "framerate");
+	auto trace_result = read_option(args, "trace");
+	auto steps_result = read_option(args, "steps-per-frame");
+	auto record_order_result = read_option(args, "record-order");
+	auto sweep_result = read_option(args, "sweep");
+	auto export_result = read_option(args, "export-frames");
+	auto export_format_result = read_option(args, "export-format");
+	auto publish_result = read_option(args, "publish");
+	auto clusters_result = read_option(args, "clusters");
+	auto cluster_every_result = read_option(args, "cluster-every");
+	auto cluster_distance_result = read_option(args, "cluster-distance");
+	auto sleep_speed_result = read_option(args, "sleep-speed");
+	auto sleep_after_result = read_option(args, "sleep-after");
+	auto far_field_result = read_option(args, "far-field");
+	auto load_csv_result = read_option(args, "load-csv");
 
 	// checking for conflicts
 
@@ -52,8 +135,56 @@ ArgumentConfig::ArgumentConfig(int argc, const char** argv):
 		errors += "Options `--record` and `--replay` cannot be combined\n";
 	}
 
-	if(!replay_result.has_value() && !recipe_result.has_value()) {
-		errors += "Either `--recipe` or `--replay` option is required\n";
+	if(sweep_result.has_value() && (recipe_result.has_value() || record_result.has_value() || replay_result.has_value())) {
+		errors += "Option `--sweep` cannot be combined with `--recipe`, `--record` or `--replay`\n";
+	}
+
+	if(!replay_result.has_value() && !recipe_result.has_value() && !sweep_result.has_value()) {
+		errors += "Either `--recipe`, `--replay` or `--sweep` option is required\n";
+	}
+
+	if(record_order_result.has_value() && !record_result.has_value()) {
+		errors += "Option `--record-order` requires `--record`\n";
+	}
+
+	if(steps_result.has_value() && replay_result.has_value()) {
+		errors += "Options `--steps-per-frame` and `--replay` cannot be combined\n";
+	}
+
+	if(export_result.has_value() && !replay_result.has_value()) {
+		errors += "Option `--export-frames` requires `--replay`\n";
+	}
+
+	if(export_format_result.has_value() && !export_result.has_value()) {
+		errors += "Option `--export-format` requires `--export-frames`\n";
+	}
+
+	if(publish_result.has_value() && (replay_result.has_value() || sweep_result.has_value())) {
+		errors += "Option `--publish` cannot be combined with `--replay` or `--sweep`\n";
+	}
+
+	if(clusters_result.has_value() && (replay_result.has_value() || sweep_result.has_value())) {
+		errors += "Option `--clusters` cannot be combined with `--replay` or `--sweep`\n";
+	}
+
+	if((cluster_every_result.has_value() || cluster_distance_result.has_value()) && !clusters_result.has_value()) {
+		errors += "Options `--cluster-every` and `--cluster-distance` require `--clusters`\n";
+	}
+
+	if(sleep_after_result.has_value() && !sleep_speed_result.has_value()) {
+		errors += "Option `--sleep-after` requires `--sleep-speed`\n";
+	}
+
+	if(sleep_speed_result.has_value() && !recipe_result.has_value()) {
+		errors += "Option `--sleep-speed` requires `--recipe`\n";
+	}
+
+	if(far_field_result.has_value() && !recipe_result.has_value()) {
+		errors += "Option `--far-field` requires `--recipe`\n";
+	}
+
+	if(load_csv_result.has_value() && !recipe_result.has_value()) {
+		errors += "Option `--load-csv` requires `--recipe`\n";
 	}
 
 	// applying values
@@ -70,6 +201,54 @@ ArgumentConfig::ArgumentConfig(int argc, const char** argv):
 		recording_path = replay_result.value();
 	}
 
+	if(trace_result.has_value()) trace_path = trace_result.value();
+	if(sweep_result.has_value()) sweep_path = sweep_result.value();
+	if(export_result.has_value()) export_path = export_result.value();
+	if(publish_result.has_value()) publish_name = publish_result.value();
+	if(clusters_result.has_value()) clusters_prefix = clusters_result.value();
+	if(load_csv_result.has_value()) load_prefix = load_csv_result.value();
+
+	if(cluster_every_result.has_value()) {
+		auto every_str = cluster_every_result.value();
+		auto maybe_every = strutil::stoi_positive(every_str);
+		if(maybe_every.has_value()) cluster_interval = maybe_every.value();
+		else errors += "`" + std::string(every_str) + "` is not a positive integer number\n";
+	}
+
+	if(cluster_distance_result.has_value()) {
+		auto distance_str = cluster_distance_result.value();
+		auto maybe_distance = strutil::stof(distance_str);
+		if(maybe_distance.has_value() && maybe_distance.value() > 0) cluster_distance = maybe_distance.value();
+		else errors += "`" + std::string(distance_str) + "` is not a positive number\n";
+	}
+
+	if(sleep_speed_result.has_value()) {
+		auto speed_str = sleep_speed_result.value();
+		auto maybe_speed = strutil::stof(speed_str);
+		if(maybe_speed.has_value() && maybe_speed.value() > 0) sleep_speed = maybe_speed.value();
+		else errors += "`" + std::string(speed_str) + "` is not a positive number\n";
+	}
+
+	if(sleep_after_result.has_value()) {
+		auto after_str = sleep_after_result.value();
+		auto maybe_after = strutil::stoi_positive(after_str);
+		if(maybe_after.has_value()) sleep_after = maybe_after.value();
+		else errors += "`" + std::string(after_str) + "` is not a positive integer number\n";
+	}
+
+	if(far_field_result.has_value()) {
+		auto fraction_str = far_field_result.value();
+		auto maybe_fraction = strutil::stof(fraction_str);
+		if(maybe_fraction.has_value() && maybe_fraction.value() > 0 && maybe_fraction.value() < 1) far_field = maybe_fraction.value();
+		else errors += "`" + std::string(fraction_str) + "` is not a number between 0 and 1\n";
+	}
+
+	if(export_format_result.has_value()) {
+		auto format = export_format_result.value();
+		if(format == "raw") export_raw = true;
+		else if(format != "png") errors += "`" + std::string(format) + "` is not a valid export format (`png` or `raw`)\n";
+	}
+
 	if(framerate_result.has_value()) {
 		auto framerate_str = framerate_result.value();
 		auto maybe_framerate = strutil::stoi_positive(framerate_str);
@@ -77,11 +256,39 @@ ArgumentConfig::ArgumentConfig(int argc, const char** argv):
 		else errors += "`" + std::string(framerate_str) + "` is not a positive integer number\n";
 	}
 
+	if(steps_result.has_value()) {
+		auto steps_str = steps_result.value();
+		auto maybe_steps = strutil::stoi_positive(steps_str);
+		if(steps_str == "auto") steps_per_frame = 0;
+		else if(maybe_steps.has_value()) steps_per_frame = maybe_steps.value();
+		else errors += "`" + std::string(steps_str) + "` is neither a positive integer number nor `auto`\n";
+	}
+
+	if(record_order_result.has_value()) {
+		auto order = record_order_result.value();
+		if(order == "id") record_in_id_order = true;
+		else if(order != "grid") errors += "`" + std::string(order) + "` is not a valid recording order (`grid` or `id`)\n";
+	}
+
 	int option_number = 0;
 	option_number += recipe_result.has_value() ? 1 : 0;
 	option_number += record_result.has_value() ? 1 : 0;
 	option_number += replay_result.has_value() ? 1 : 0;
 	option_number += framerate_result.has_value() ? 1 : 0;
+	option_number += trace_result.has_value() ? 1 : 0;
+	option_number += steps_result.has_value() ? 1 : 0;
+	option_number += record_order_result.has_value() ? 1 : 0;
+	option_number += sweep_result.has_value() ? 1 : 0;
+	option_number += export_result.has_value() ? 1 : 0;
+	option_number += export_format_result.has_value() ? 1 : 0;
+	option_number += publish_result.has_value() ? 1 : 0;
+	option_number += clusters_result.has_value() ? 1 : 0;
+	option_number += cluster_every_result.has_value() ? 1 : 0;
+	option_number += cluster_distance_result.has_value() ? 1 : 0;
+	option_number += sleep_speed_result.has_value() ? 1 : 0;
+	option_number += sleep_after_result.has_value() ? 1 : 0;
+	option_number += far_field_result.has_value() ? 1 : 0;
+	option_number += load_csv_result.has_value() ? 1 : 0;
 
 	int expected_args = (option_number * 2) + 1;
 
@@ -17,7 +17,21 @@ private:
 	RecordingState recording_state;
 	std::string_view recipe_path;
 	std::string_view recording_path;
+	std::string_view trace_path;
+	std::string_view sweep_path;
+	std::string_view export_path;
+	bool export_raw;
+	std::string_view publish_name;
+	std::string_view clusters_prefix;
+	int cluster_interval;
+	float cluster_distance;
+	float sleep_speed;
+	int sleep_after;
+	float far_field;
+	std::string_view load_prefix;
+	bool record_in_id_order;
 	int framerate;
+	int steps_per_frame;
 	std::string errors;
 
 	std::optional<std::string_view> read_option(
@@ -30,6 +44,31 @@ public:
 	RecordingState get_recording_state() const;
 	std::string_view get_recipe_path() const;
 	std::string_view get_recording_path() const;
+	std::string_view get_trace_path() const;
+	// empty when not running a sweep
+	std::string_view get_sweep_path() const;
+	// empty when not exporting frames
+	std::string_view get_export_path() const;
+	// raw RGBA frames instead of PNG files
+	bool get_export_raw() const;
+	// name of the shared memory frames are published to; empty when not publishing
+	std::string_view get_publish_name() const;
+	// cluster analysis results go to `<prefix>_summary.csv` and `<prefix>_clusters.csv`; empty when not analyzing
+	std::string_view get_clusters_prefix() const;
+	// in simulation steps
+	int get_cluster_interval() const;
+	float get_cluster_distance() const;
+	// 0 when particles never go to sleep
+	float get_sleep_speed() const;
+	// in simulation steps
+	int get_sleep_after() const;
+	// 0 when every particle is simulated exactly; see Simulation::enable_far_field()
+	float get_far_field() const;
+	// load of every frame goes to `<prefix>_threads.csv` and `<prefix>_cells_<step>.csv`; empty when not exporting it
+	std::string_view get_load_prefix() const;
+	bool get_record_in_id_order() const;
 	int get_framerate() const;
+	// 0 means as many as fit in the frame
+	int get_steps_per_frame() const;
 	std::string_view get_errors() const;
 };
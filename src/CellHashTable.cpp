@@ -0,0 +1,51 @@
+#include "CellHashTable.hpp"
+#include <algorithm>
+
+CellHashTable::CellHashTable():
+	slots(1, Slot { 0, 0, 0 }),
+	mask(0),
+	shift(64)
+{}
+
+std::size_t CellHashTable::slot_of(std::uint64_t key) const {
+	// fibonacci hashing; consecutive cells end up far apart
+	if(shift == 64) return 0;
+	return (key * 11400714819323198485ull) >> shift;
+}
+
+void CellHashTable::reset(std::size_t cell_count) {
+	// at most half full so that probe sequences stay short
+	std::size_t capacity = 1;
+	int bits = 0;
+	while(capacity < cell_count * 2) {
+		capacity *= 2;
+		++bits;
+	}
+
+	mask = capacity - 1;
+	shift = 64 - bits;
+
+	if(slots.size() != capacity) slots.assign(capacity, Slot { 0, 0, 0 });
+	else std::fill(slots.begin(), slots.end(), Slot { 0, 0, 0 });
+}
+
+void CellHashTable::insert(std::uint64_t cell, std::size_t start, std::size_t end) {
+	std::uint64_t key = cell + 1;
+	std::size_t i = slot_of(key);
+	while(slots[i].key != 0 && slots[i].key != key) i = (i + 1) & mask;
+	slots[i] = Slot { key, start, end };
+}
+
+std::pair<std::size_t, std::size_t> CellHashTable::find(std::uint64_t cell) const {
+	std::uint64_t key = cell + 1;
+	std::size_t i = slot_of(key);
+	while(slots[i].key != 0) {
+		if(slots[i].key == key) return { slots[i].start, slots[i].end };
+		i = (i + 1) & mask;
+	}
+	return { 0, 0 };
+}
+
+std::size_t CellHashTable::get_capacity() const {
+	return slots.size();
+}
@@ -0,0 +1,36 @@
+#pragma once
+
+#include <vector>
+#include <cstdint>
+#include <utility>
+
+/* Maps grid cell numbers to the range of particles in that cell.
+ * Only non-empty cells are stored, so memory depends on how many cells are occupied
+ * rather than on the size of the board.
+ * It's open addressing with linear probing, meant to be rebuilt from scratch
+ * after every sort rather than updated.
+ */
+
+class CellHashTable {
+	struct Slot {
+		std::uint64_t key; // cell number + 1; 0 means the slot is empty
+		std::size_t start;
+		std::size_t end;
+	};
+
+	std::vector<Slot> slots;
+	std::uint64_t mask;
+	int shift;
+
+	std::size_t slot_of(std::uint64_t key) const;
+
+public:
+	CellHashTable();
+
+	// removes everything and makes room for `cell_count` cells
+	void reset(std::size_t cell_count);
+	void insert(std::uint64_t cell, std::size_t start, std::size_t end);
+	// returns {0, 0} for empty cells
+	std::pair<std::size_t, std::size_t> find(std::uint64_t cell) const;
+	std::size_t get_capacity() const;
+};
@@ -0,0 +1,178 @@
+#include "ClusterAnalysis.hpp"
+#include <algorithm>
+#include <iomanip>
+#include <memory_resource>
+#include "Trace.hpp"
+
+ClusterAnalysis::ClusterAnalysis(const Recipe& recipe, float distance):
+	distance(distance),
+	histogram(histogram_bins, 0),
+	particle_count(0)
+{
+	auto add_species = [&](core::Color color) {
+		if(std::find(species_colors.begin(), species_colors.end(), color) == species_colors.end()) {
+			species_colors.push_back(color);
+		}
+	};
+
+	for(const auto& step : recipe.get_steps()) {
+		if(std::holds_alternative<Recipe::Particles>(step)) add_species(std::get<Recipe::Particles>(step).color);
+		else if(std::holds_alternative<Recipe::Emitter>(step)) add_species(std::get<Recipe::Emitter>(step).color);
+		else if(std::holds_alternative<Rule>(step)) {
+			add_species(std::get<Rule>(step).particle1_color);
+			add_species(std::get<Rule>(step).particle2_color);
+		}
+	}
+}
+
+// path halving; other threads may be linking roots at the same time, which only makes paths shorter
+std::uint32_t ClusterAnalysis::find(std::uint32_t i) {
+	while(true) {
+		auto parent = parents[i].load(std::memory_order_relaxed);
+		if(parent == i) return i;
+
+		auto grandparent = parents[parent].load(std::memory_order_relaxed);
+		if(parent != grandparent) parents[i].compare_exchange_weak(parent, grandparent, std::memory_order_relaxed);
+		i = grandparent;
+	}
+}
+
+void ClusterAnalysis::unite(std::uint32_t a, std::uint32_t b) {
+	while(true) {
+		a = find(a);
+		b = find(b);
+		if(a == b) return;
+
+		// roots are always linked to a smaller index so no cycles can form;
+		// if `a` stopped being a root in the meantime, try again
+		if(a < b) std::swap(a, b);
+		auto expected = a;
+		if(parents[a].compare_exchange_strong(expected, b)) return;
+	}
+}
+
+void ClusterAnalysis::link_neighbours(const ParticleGrid& grid) {
+	const auto& particle_vec = grid.get_particles();
+	const float distance_squared = distance * distance;
+
+	#pragma omp parallel
+	{
+		// one buffer per thread for all of its queries; this runs between steps, where nothing
+		// resets the frame arenas, so it comes from the heap and is freed at the end
+		ParticleGrid::Ranges ranges(std::pmr::new_delete_resource());
+
+		#pragma omp for schedule(dynamic, 256)
+		for(int i=0; i<static_cast<int>(particle_vec.size()); ++i) {
+			const auto& particle1 = particle_vec[i];
+			auto area = core::FloatRect(particle1.position.x - distance, particle1.position.y - distance, distance * 2, distance * 2);
+
+			grid.get_ranges_in(area, ranges);
+			for(const auto& range : ranges) {
+				// every pair is looked at from both sides, once is enough
+				for(std::size_t j = std::max(range.first, static_cast<std::size_t>(i) + 1); j < range.second; ++j) {
+					auto offset = particle_vec[j].position - particle1.position;
+					if(offset.x * offset.x + offset.y * offset.y > distance_squared) continue;
+					unite(i, j);
+				}
+			}
+		}
+	}
+}
+
+std::size_t ClusterAnalysis::species_of(core::Color color) const {
+	auto found = std::find(species_colors.begin(), species_colors.end(), color);
+	return found - species_colors.begin();
+}
+
+void ClusterAnalysis::collect_clusters(const ParticleGrid& grid) {
+	const auto& particle_vec = grid.get_particles();
+	const auto no_cluster = UINT32_MAX;
+
+	// sizes of all components first, for the histogram
+	std::vector<std::uint32_t> sizes(particle_count, 0);
+	for(std::uint32_t i=0; i<particle_count; ++i) ++sizes[find(i)];
+
+	std::fill(histogram.begin(), histogram.end(), 0);
+	clusters.clear();
+	cluster_of_root.assign(particle_count, no_cluster);
+
+	for(std::uint32_t i=0; i<particle_count; ++i) {
+		if(sizes[i] == 0) continue;
+
+		std::size_t bin = 0;
+		while((2u << bin) <= sizes[i] && bin + 1 < histogram_bins) ++bin;
+		++histogram[bin];
+
+		if(sizes[i] < min_cluster_size) continue;
+		cluster_of_root[i] = clusters.size();
+		// one more species count for colors that aren't in the recipe
+		clusters.push_back(Cluster { 0, {0, 0}, std::vector<std::size_t>(species_colors.size() + 1, 0) });
+	}
+
+	for(std::uint32_t i=0; i<particle_count; ++i) {
+		auto cluster_index = cluster_of_root[find(i)];
+		if(cluster_index == no_cluster) continue;
+
+		auto& cluster = clusters[cluster_index];
+		++cluster.size;
+		cluster.center += particle_vec[i].position;
+		++cluster.species_counts[species_of(particle_vec[i].color)];
+	}
+
+	for(auto& cluster : clusters) cluster.center /= static_cast<float>(cluster.size);
+
+	std::stable_sort(clusters.begin(), clusters.end(), [](const Cluster& c1, const Cluster& c2) {
+		return c1.size > c2.size;
+	});
+}
+
+void ClusterAnalysis::analyze(const ParticleGrid& grid) {
+	trace::Span analysis_span("cluster analysis");
+
+	particle_count = grid.get_particles().size();
+	if(parents.size() != particle_count) parents = std::vector<std::atomic<std::uint32_t>>(particle_count);
+
+	#pragma omp parallel for schedule(static)
+	for(int i=0; i<static_cast<int>(particle_count); ++i) {
+		parents[i].store(i, std::memory_order_relaxed);
+	}
+
+	link_neighbours(grid);
+	collect_clusters(grid);
+}
+
+const std::vector<ClusterAnalysis::Cluster>& ClusterAnalysis::get_clusters() const {
+	return clusters;
+}
+
+const std::vector<std::size_t>& ClusterAnalysis::get_histogram() const {
+	return histogram;
+}
+
+void ClusterAnalysis::write_csv_headers(std::ostream& summary_out, std::ostream& clusters_out) const {
+	summary_out << "step,particles,clusters,largest";
+	for(std::size_t bin = 0; bin < histogram_bins; ++bin) {
+		summary_out << ",size_" << (1u << bin) << "_" << (2u << bin) - 1;
+	}
+	summary_out << "\n";
+
+	clusters_out << "step,cluster,size,center_x,center_y";
+	for(const auto& color : species_colors) {
+		clusters_out << ",species_" << std::hex << std::setfill('0') << std::setw(8) << color.toInteger() << std::dec;
+	}
+	clusters_out << ",species_other\n";
+}
+
+void ClusterAnalysis::write_csv(std::uint64_t step, std::ostream& summary_out, std::ostream& clusters_out) const {
+	summary_out << step << "," << particle_count << "," << clusters.size() << ","
+	            << (clusters.empty() ? 0 : clusters.front().size);
+	for(auto count : histogram) summary_out << "," << count;
+	summary_out << "\n";
+
+	for(std::size_t i=0; i<clusters.size(); ++i) {
+		const auto& cluster = clusters[i];
+		clusters_out << step << "," << i << "," << cluster.size << "," << cluster.center.x << "," << cluster.center.y;
+		for(auto count : cluster.species_counts) clusters_out << "," << count;
+		clusters_out << "\n";
+	}
+}
@@ -0,0 +1,62 @@
+#pragma once
+
+#include <vector>
+#include <atomic>
+#include <cstdint>
+#include <ostream>
+#include "CoreTypes.hpp"
+#include "ParticleGrid.hpp"
+#include "Recipe.hpp"
+
+/* Finds the structures particles clump into: two particles closer than `distance`
+ * are in the same cluster. Neighbours are looked up in the grid like in the force loop,
+ * and the clusters are joined with a lock free union-find so all threads can work on it at once.
+ *
+ * Results can be written as two CSV files: a summary of every analysis (cluster count and
+ * a histogram of cluster sizes) and a row per cluster with its species composition.
+ */
+
+class ClusterAnalysis {
+public:
+	// smaller groups only show up in the histogram
+	static const std::size_t min_cluster_size = 5;
+	// histogram bin b counts clusters of 2^b to 2^(b+1)-1 particles
+	static const std::size_t histogram_bins = 24;
+
+	struct Cluster {
+		std::size_t size;
+		core::Vector2f center;
+		// indexed like the species colors
+		std::vector<std::size_t> species_counts;
+	};
+
+private:
+	float distance;
+	// every color used in the recipe
+	std::vector<core::Color> species_colors;
+
+	std::vector<std::atomic<std::uint32_t>> parents;
+	std::vector<std::uint32_t> cluster_of_root;
+	std::vector<Cluster> clusters;
+	std::vector<std::size_t> histogram;
+	std::size_t particle_count;
+
+	std::uint32_t find(std::uint32_t i);
+	void unite(std::uint32_t a, std::uint32_t b);
+	void link_neighbours(const ParticleGrid& grid);
+	void collect_clusters(const ParticleGrid& grid);
+	std::size_t species_of(core::Color color) const;
+
+public:
+	ClusterAnalysis(const Recipe& recipe, float distance);
+
+	void analyze(const ParticleGrid& grid);
+
+	// clusters of at least min_cluster_size particles, largest first
+	const std::vector<Cluster>& get_clusters() const;
+	const std::vector<std::size_t>& get_histogram() const;
+
+	void write_csv_headers(std::ostream& summary_out, std::ostream& clusters_out) const;
+	// results of the last analyze()
+	void write_csv(std::uint64_t step, std::ostream& summary_out, std::ostream& clusters_out) const;
+};
@@ -6,7 +6,10 @@
 
 Config::Config():
 	target_fps(default_fps),
-	threads(default_threads)
+	threads(default_threads),
+	huge_pages("none"),
+	cell_order("rows"),
+	frame_governor(false)
 {}
 
 Config::Config(const std::string& filename):
@@ -31,6 +34,36 @@ Config::Config(const std::string& filename):
 			continue;
 		}
 
+		if(keyval.first == "thread_binding") {
+			if(keyval.second == "close" || keyval.second == "spread" || keyval.second == "none") thread_binding = keyval.second;
+			else errors += std::string("Must be `close`, `spread` or `none`: \"") + keyval.second + "\"\n";
+			continue;
+		}
+
+		if(keyval.first == "thread_places") {
+			if(keyval.second == "threads" || keyval.second == "cores" || keyval.second == "sockets") thread_places = keyval.second;
+			else errors += std::string("Must be `threads`, `cores` or `sockets`: \"") + keyval.second + "\"\n";
+			continue;
+		}
+
+		if(keyval.first == "huge_pages") {
+			if(keyval.second == "none" || keyval.second == "transparent" || keyval.second == "explicit") huge_pages = keyval.second;
+			else errors += std::string("Must be `none`, `transparent` or `explicit`: \"") + keyval.second + "\"\n";
+			continue;
+		}
+
+		if(keyval.first == "cell_order") {
+			if(keyval.second == "rows" || keyval.second == "morton") cell_order = keyval.second;
+			else errors += std::string("Must be `rows` or `morton`: \"") + keyval.second + "\"\n";
+			continue;
+		}
+
+		if(keyval.first == "frame_governor") {
+			if(keyval.second == "on" || keyval.second == "off") frame_governor = keyval.second == "on";
+			else errors += std::string("Must be `on` or `off`: \"") + keyval.second + "\"\n";
+			continue;
+		}
+
 		auto maybe_value = strutil::stoi_nonegative(keyval.second);
 		if(!maybe_value.has_value()) {
 			errors += std::string("Must be a non-negative integer: \"") + keyval.second + "\"\n";
@@ -67,6 +100,26 @@ int Config::get_threads() const {
 	return threads;
 }
 
+const std::string& Config::get_thread_binding() const {
+	return thread_binding;
+}
+
+const std::string& Config::get_thread_places() const {
+	return thread_places;
+}
+
+const std::string& Config::get_huge_pages() const {
+	return huge_pages;
+}
+
+const std::string& Config::get_cell_order() const {
+	return cell_order;
+}
+
+bool Config::get_frame_governor() const {
+	return frame_governor;
+}
+
 const std::string& Config::get_errors() const {
 	return errors;
 }
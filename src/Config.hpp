@@ -10,6 +10,15 @@ class Config {
 
 	int target_fps;
 	int threads;
+	// pin the threads like OMP_PROC_BIND and OMP_PLACES would (see ThreadAffinity.hpp); empty when not set
+	std::string thread_binding;
+	std::string thread_places;
+	// none, transparent or explicit; see particle_memory::HugePages
+	std::string huge_pages;
+	// rows or morton; see ParticleGrid::CellOrder
+	std::string cell_order;
+	// see FrameGovernor
+	bool frame_governor;
 	std::string errors;
 
 	std::pair<std::string, std::string> line_to_keyvalue(const std::string& line);
@@ -21,5 +30,10 @@ public:
 
 	int get_target_fps() const;
 	int get_threads() const;
+	const std::string& get_thread_binding() const;
+	const std::string& get_thread_places() const;
+	const std::string& get_huge_pages() const;
+	const std::string& get_cell_order() const;
+	bool get_frame_governor() const;
 	const std::string& get_errors() const;
 };
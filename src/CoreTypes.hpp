@@ -0,0 +1,113 @@
+#pragma once
+
+#include <cstdint>
+#include <algorithm>
+
+/* The few geometry and colour types the simulation works with, so that it doesn't need SFML
+ * (see somelife_core in CMakeLists.txt). They have the same members and about the same operators
+ * as their SFML counterparts, but they're plain standard layout structs:
+ * a Vector2f is two floats and a Color four bytes, whatever SFML version is around.
+ * The window converts them where it hands them over to SFML (see SfmlTypes.hpp).
+ */
+
+namespace core {
+	template<typename T>
+	struct Vector2 {
+		T x = 0;
+		T y = 0;
+
+		Vector2() = default;
+		constexpr Vector2(T x, T y): x(x), y(y) {}
+		template<typename U>
+		constexpr explicit Vector2(const Vector2<U>& other): x(static_cast<T>(other.x)), y(static_cast<T>(other.y)) {}
+
+		Vector2& operator+=(Vector2 other) { x += other.x; y += other.y; return *this; }
+		Vector2& operator-=(Vector2 other) { x -= other.x; y -= other.y; return *this; }
+		Vector2& operator*=(T factor) { x *= factor; y *= factor; return *this; }
+		Vector2& operator/=(T divisor) { x /= divisor; y /= divisor; return *this; }
+	};
+
+	template<typename T>
+	constexpr Vector2<T> operator-(Vector2<T> vector) { return { -vector.x, -vector.y }; }
+	template<typename T>
+	constexpr Vector2<T> operator+(Vector2<T> left, Vector2<T> right) { return { left.x + right.x, left.y + right.y }; }
+	template<typename T>
+	constexpr Vector2<T> operator-(Vector2<T> left, Vector2<T> right) { return { left.x - right.x, left.y - right.y }; }
+	template<typename T>
+	constexpr Vector2<T> operator*(Vector2<T> vector, T factor) { return { vector.x * factor, vector.y * factor }; }
+	template<typename T>
+	constexpr Vector2<T> operator*(T factor, Vector2<T> vector) { return { vector.x * factor, vector.y * factor }; }
+	template<typename T>
+	constexpr Vector2<T> operator/(Vector2<T> vector, T divisor) { return { vector.x / divisor, vector.y / divisor }; }
+	template<typename T>
+	constexpr bool operator==(Vector2<T> left, Vector2<T> right) { return left.x == right.x && left.y == right.y; }
+	template<typename T>
+	constexpr bool operator!=(Vector2<T> left, Vector2<T> right) { return !(left == right); }
+
+	using Vector2f = Vector2<float>;
+	using Vector2i = Vector2<int>;
+
+	struct Color {
+		std::uint8_t r = 0;
+		std::uint8_t g = 0;
+		std::uint8_t b = 0;
+		std::uint8_t a = 255;
+
+		Color() = default;
+		constexpr Color(std::uint8_t r, std::uint8_t g, std::uint8_t b, std::uint8_t a = 255): r(r), g(g), b(b), a(a) {}
+		// 0xRRGGBBAA, the same as sf::Color
+		constexpr explicit Color(std::uint32_t color):
+			r(static_cast<std::uint8_t>(color >> 24)),
+			g(static_cast<std::uint8_t>(color >> 16)),
+			b(static_cast<std::uint8_t>(color >> 8)),
+			a(static_cast<std::uint8_t>(color))
+		{}
+
+		constexpr std::uint32_t toInteger() const {
+			return (std::uint32_t(r) << 24) | (std::uint32_t(g) << 16) | (std::uint32_t(b) << 8) | a;
+		}
+
+		static const Color Black;
+		static const Color White;
+		static const Color Red;
+		static const Color Green;
+		static const Color Blue;
+		static const Color Yellow;
+		static const Color Magenta;
+		static const Color Cyan;
+		static const Color Transparent;
+	};
+
+	inline const Color Color::Black(0, 0, 0);
+	inline const Color Color::White(255, 255, 255);
+	inline const Color Color::Red(255, 0, 0);
+	inline const Color Color::Green(0, 255, 0);
+	inline const Color Color::Blue(0, 0, 255);
+	inline const Color Color::Yellow(255, 255, 0);
+	inline const Color Color::Magenta(255, 0, 255);
+	inline const Color Color::Cyan(0, 255, 255);
+	inline const Color Color::Transparent(0, 0, 0, 0);
+
+	constexpr bool operator==(Color left, Color right) { return left.toInteger() == right.toInteger(); }
+	constexpr bool operator!=(Color left, Color right) { return !(left == right); }
+
+	struct FloatRect {
+		float left = 0;
+		float top = 0;
+		float width = 0;
+		float height = 0;
+
+		FloatRect() = default;
+		constexpr FloatRect(float left, float top, float width, float height): left(left), top(top), width(width), height(height) {}
+		constexpr FloatRect(Vector2f position, Vector2f size): left(position.x), top(position.y), width(size.x), height(size.y) {}
+
+		// like sf::FloatRect: the left and top edges are inside, the other two aren't
+		bool contains(Vector2f point) const {
+			float min_x = std::min(left, left + width);
+			float max_x = std::max(left, left + width);
+			float min_y = std::min(top, top + height);
+			float max_y = std::max(top, top + height);
+			return point.x >= min_x && point.x < max_x && point.y >= min_y && point.y < max_y;
+		}
+	};
+}
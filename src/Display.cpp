@@ -1,15 +1,40 @@
 #include "Display.hpp"
+#include <cmath>
+#include <algorithm>
+#include "SfmlTypes.hpp"
 
-Display::Display(int width, int height, std::string title, int framerate):
+using sfml_types::to_sf;
+using sfml_types::to_core;
+
+Display::Display(sf::Vector2i window_size, sf::Vector2i world_size, std::string title, int framerate):
 	window(sf::RenderWindow(
-				sf::VideoMode(width, height), 
+				sf::VideoMode(window_size.x, window_size.y), 
 				title, 
 				sf::Style::Close,
 				sf::ContextSettings(0, 0, 8)
-	))
+	)),
+	point(POINT_RADIUS, 6),
+	world_size(world_size),
+	dragging(false),
+	lod_enabled(true),
+	detail(Detail::Hexagons),
+	blobs(sf::Quads),
+	dots(sf::Quads),
+	load_shown(false),
+	load_quads(sf::Quads)
 {
 	if(framerate > 0) window.setFramerateLimit(framerate);
 	font.loadFromFile("res/DejaVuSans.ttf");
+	reset_camera();
+
+	point.setOrigin(POINT_RADIUS, POINT_RADIUS);
+
+	framerate_text.setFont(font);
+	framerate_text.setCharacterSize(15);
+	framerate_text.setFillColor(sf::Color::White);
+	framerate_text.setOutlineColor(sf::Color::Black);
+	framerate_text.setOutlineThickness(2);
+	framerate_text.setPosition(5, 5);
 }
 
 const sf::RenderWindow& Display::get_window() const {
@@ -20,42 +45,318 @@ bool Display::window_is_open() const {
 	return window.isOpen();
 }
 
+void Display::set_detail(Detail detail) {
+	this->detail = detail;
+}
+
+bool Display::load_overlay_shown() const {
+	return load_shown;
+}
+
+void Display::set_load(const std::vector<std::uint32_t>& cell_pairs, const std::vector<float>& thread_busy_ms) {
+	load_cell_pairs.assign(cell_pairs.begin(), cell_pairs.end());
+	load_thread_busy_ms.assign(thread_busy_ms.begin(), thread_busy_ms.end());
+}
+
 void Display::draw_point(sf::Vector2f pos, sf::Color color) {
-	auto circle = sf::CircleShape(POINT_RADIUS, 6);
-	circle.setFillColor(color);
-	circle.setOrigin(POINT_RADIUS, POINT_RADIUS);
-	circle.setPosition(pos);
-	window.draw(circle);
+	point.setFillColor(color);
+	point.setPosition(pos);
+	window.draw(point);
+}
+
+void Display::add_dot(sf::Vector2f pos, sf::Color color) {
+	const float r = POINT_RADIUS;
+	dots.append(sf::Vertex(pos + sf::Vector2f(-r, -r), color));
+	dots.append(sf::Vertex(pos + sf::Vector2f(r, -r), color));
+	dots.append(sf::Vertex(pos + sf::Vector2f(r, r), color));
+	dots.append(sf::Vertex(pos + sf::Vector2f(-r, r), color));
+}
+
+float Display::pixels_per_unit() const {
+	return window.getSize().x / camera.getSize().x;
+}
+
+std::size_t Display::species_of(sf::Color color) {
+	// there's only a handful of colors in a recipe
+	for(std::size_t i=0; i<species_colors.size(); ++i) {
+		if(species_colors[i] == color) return i;
+	}
+	species_colors.push_back(color);
+	block_species_counts.emplace_back(block_totals.size(), 0);
+	return species_colors.size() - 1;
+}
+
+void Display::draw_blobs(const ParticleGrid& particles, sf::FloatRect area) {
+	const auto& particle_vec = particles.get_particles();
+	auto grid_size = particles.get_grid_size();
+	auto cell_size = to_sf(particles.get_cell_size());
+
+	// a hexagon covers about 2.6 r^2
+	const float point_area = 2.6f * POINT_RADIUS * POINT_RADIUS;
+
+	int block = std::ceil(lod_min_blob_pixels / (std::min(cell_size.x, cell_size.y) * pixels_per_unit()));
+	block = std::max(block, 1);
+	auto blob_size = cell_size * static_cast<float>(block);
+
+	// blocks are aligned to the grid so blobs don't shimmer when the camera moves
+	int first_x = std::max(0, static_cast<int>(area.left / cell_size.x) / block * block);
+	int first_y = std::max(0, static_cast<int>(area.top / cell_size.y) / block * block);
+	int last_x = std::min(grid_size.x - 1, static_cast<int>((area.left + area.width) / cell_size.x));
+	int last_y = std::min(grid_size.y - 1, static_cast<int>((area.top + area.height) / cell_size.y));
+	int blocks_x = std::max(0, (last_x - first_x) / block + 1);
+	int blocks_y = std::max(0, (last_y - first_y) / block + 1);
+
+	// the grid keeps the particles of every cell sorted by species, so a species' count is the size of its range
+	// and the particles themselves aren't looked at; only the last species, every colour without a rule table
+	// entry (all of them when the recipe has no table), has to be told apart particle by particle
+	int species_count = particles.get_species_count();
+	display_species.clear();
+	for(int s = 0; s < species_count - 1; ++s) display_species.push_back(species_of(to_sf(particles.get_species_color(s))));
+
+	block_totals.assign(blocks_x * blocks_y, 0);
+	for(auto& counts : block_species_counts) counts.assign(block_totals.size(), 0);
+
+	for(int y = first_y; y <= last_y; ++y) {
+		for(int x = first_x; x <= last_x; ++x) {
+			std::size_t n = (y - first_y) / block * blocks_x + (x - first_x) / block;
+
+			for(int s = 0; s < species_count; ++s) {
+				auto range = particles.get_cell_range({x, y}, s);
+				if(range.first == range.second) continue;
+				block_totals[n] += range.second - range.first;
+
+				if(s < species_count - 1) {
+					block_species_counts[display_species[s]][n] += range.second - range.first;
+					continue;
+				}
+				for(std::size_t i = range.first; i < range.second; ++i) {
+					++block_species_counts[species_of(to_sf(particle_vec[i].color))][n];
+				}
+			}
+		}
+	}
+
+	blobs.clear();
+
+	for(int y = 0; y < blocks_y; ++y) {
+		for(int x = 0; x < blocks_x; ++x) {
+			std::size_t n = y * blocks_x + x;
+			int total = block_totals[n];
+			if(total == 0) continue;
+
+			// species mixed by their share, opacity by how much of the blob the particles would cover
+			float r = 0, g = 0, b = 0;
+			for(std::size_t s=0; s<species_colors.size(); ++s) {
+				float share = static_cast<float>(block_species_counts[s][n]) / total;
+				r += species_colors[s].r * share;
+				g += species_colors[s].g * share;
+				b += species_colors[s].b * share;
+			}
+			float coverage = std::min(1.f, total * point_area / (blob_size.x * blob_size.y));
+			auto color = sf::Color(r, g, b, 255 * coverage);
+
+			auto corner = sf::Vector2f((first_x + x * block) * cell_size.x, (first_y + y * block) * cell_size.y);
+			blobs.append(sf::Vertex(corner, color));
+			blobs.append(sf::Vertex(corner + sf::Vector2f(blob_size.x, 0), color));
+			blobs.append(sf::Vertex(corner + blob_size, color));
+			blobs.append(sf::Vertex(corner + sf::Vector2f(0, blob_size.y), color));
+		}
+	}
+
+	window.draw(blobs);
+}
+
+void Display::add_quad(sf::Vector2f corner, sf::Vector2f size, sf::Color color) {
+	load_quads.append(sf::Vertex(corner, color));
+	load_quads.append(sf::Vertex(corner + sf::Vector2f(size.x, 0), color));
+	load_quads.append(sf::Vertex(corner + size, color));
+	load_quads.append(sf::Vertex(corner + sf::Vector2f(0, size.y), color));
+}
+
+void Display::draw_load(const ParticleGrid& particles, sf::FloatRect area) {
+	auto grid_size = particles.get_grid_size();
+	auto cell_size = to_sf(particles.get_cell_size());
+	load_quads.clear();
+
+	// cells from blue (little work) to red (the most work of the visible cells)
+	if(load_cell_pairs.size() == static_cast<std::size_t>(grid_size.x) * grid_size.y) {
+		int first_x = std::max(0, static_cast<int>(area.left / cell_size.x));
+		int first_y = std::max(0, static_cast<int>(area.top / cell_size.y));
+		int last_x = std::min(grid_size.x - 1, static_cast<int>((area.left + area.width) / cell_size.x));
+		int last_y = std::min(grid_size.y - 1, static_cast<int>((area.top + area.height) / cell_size.y));
+
+		std::uint32_t most_pairs = 1;
+		for(int y = first_y; y <= last_y; ++y) {
+			for(int x = first_x; x <= last_x; ++x) most_pairs = std::max(most_pairs, load_cell_pairs[y * grid_size.x + x]);
+		}
+
+		for(int y = first_y; y <= last_y; ++y) {
+			for(int x = first_x; x <= last_x; ++x) {
+				auto pairs = load_cell_pairs[y * grid_size.x + x];
+				if(pairs == 0) continue;
+
+				float heat = static_cast<float>(pairs) / most_pairs;
+				auto color = sf::Color(255 * heat, 64 * (1 - heat), 255 * (1 - heat), 64 + 128 * heat);
+				add_quad(sf::Vector2f(x * cell_size.x, y * cell_size.y), cell_size, color);
+			}
+		}
+		window.draw(load_quads);
+		load_quads.clear();
+	}
+
+	// one bar per thread in the bottom left corner; grey is the time it waited for the slowest thread
+	if(load_thread_busy_ms.empty()) return;
+	float slowest = *std::max_element(load_thread_busy_ms.begin(), load_thread_busy_ms.end());
+	if(slowest <= 0) return;
+	window.setView(window.getDefaultView());
+
+	float bottom = window.getSize().y - 5;
+	for(std::size_t thread = 0; thread < load_thread_busy_ms.size(); ++thread) {
+		auto corner = sf::Vector2f(5, bottom - (thread + 1) * (load_bar_height + 2));
+		float busy_width = load_bar_width * load_thread_busy_ms[thread] / slowest;
+		add_quad(corner, sf::Vector2f(load_bar_width, load_bar_height), sf::Color(80, 80, 80));
+		add_quad(corner, sf::Vector2f(busy_width, load_bar_height), sf::Color(80, 220, 80));
+	}
+	window.draw(load_quads);
 }
 
 void Display::print_framerate(int framerate) {
-	sf::Text text(sf::String(std::to_string(framerate) + " FPS"), font, 15);
-	text.setFillColor(sf::Color::White);
-	text.setOutlineColor(sf::Color::Black);
-	text.setOutlineThickness(2);
-	text.setPosition(5, 5);
-	window.draw(text);
+	auto now = std::chrono::steady_clock::now();
+	if(now - framerate_text_updated > std::chrono::milliseconds(500)) {
+		framerate_text.setString(std::to_string(framerate) + " FPS");
+		framerate_text_updated = now;
+	}
+	window.draw(framerate_text);
+}
+
+void Display::finish_frame(int framerate) {
+	window.setView(window.getDefaultView());
+	print_framerate(framerate);
+	window.display();
+}
+
+void Display::reset_camera() {
+	// fit the whole world in the window, keeping the aspect ratio of the window
+	auto window_size = sf::Vector2f(window.getSize());
+	float scale = std::max(world_size.x / window_size.x, world_size.y / window_size.y);
+	camera.setSize(window_size * scale);
+	camera.setCenter(world_size / 2.f);
+}
+
+void Display::zoom_camera(sf::Vector2i pixel, float factor) {
+	// keep the point under the cursor in place
+	auto before = window.mapPixelToCoords(pixel, camera);
+	camera.zoom(factor);
+	auto after = window.mapPixelToCoords(pixel, camera);
+	camera.move(before - after);
+}
+
+void Display::move_camera(sf::Vector2i from_pixel, sf::Vector2i to_pixel) {
+	auto from = window.mapPixelToCoords(from_pixel, camera);
+	auto to = window.mapPixelToCoords(to_pixel, camera);
+	camera.move(from - to);
+}
+
+sf::FloatRect Display::get_visible_area() const {
+	// points sticking into the window from the outside count as visible
+	auto size = camera.getSize() + sf::Vector2f(POINT_RADIUS * 2, POINT_RADIUS * 2);
+	auto corner = camera.getCenter() - size / 2.f;
+	return sf::FloatRect(corner, size);
 }
 
 void Display::draw_window(const ParticleGrid& particles, int framerate) {
-	draw_window(particles.get_particles(), framerate);
+	window.clear(sf::Color::Black);
+	window.setView(camera);
+
+	// only walk the grid rows that can be seen
+	auto visible_area = get_visible_area();
+	const auto& particle_vec = particles.get_particles();
+	auto visible_ranges = particles.get_ranges_in(to_core(visible_area));
+
+	// rows stick out of the visible area a bit, so this overestimates somewhat
+	std::size_t visible_count = 0;
+	for(const auto& range : visible_ranges) visible_count += range.second - range.first;
+
+	auto window_size = window.getSize();
+	bool too_dense = lod_enabled && visible_count * lod_pixels_per_particle > window_size.x * window_size.y;
+	if(too_dense || detail == Detail::Blobs) {
+		draw_blobs(particles, visible_area);
+	} else if(detail == Detail::Dots) {
+		// clear() keeps the memory, so this only allocates when there's more to draw than ever before
+		dots.clear();
+		for(const auto& range : visible_ranges) {
+			for(std::size_t i = range.first; i < range.second; ++i) {
+				auto position = to_sf(particle_vec[i].position);
+				if(visible_area.contains(position)) add_dot(position, to_sf(particle_vec[i].color));
+			}
+		}
+		window.draw(dots);
+	} else {
+		for(const auto& range : visible_ranges) {
+			for(std::size_t i = range.first; i < range.second; ++i) {
+				auto position = to_sf(particle_vec[i].position);
+				if(visible_area.contains(position)) draw_point(position, to_sf(particle_vec[i].color));
+			}
+		}
+	}
+
+	if(load_shown) draw_load(particles, visible_area);
+	finish_frame(framerate);
 }
 
 void Display::draw_window(const std::vector<Particle>& particles, int framerate) {
 	window.clear(sf::Color::Black);
+	window.setView(camera);
 
+	auto visible_area = get_visible_area();
 	for(const auto& particle : particles) {
-		draw_point(particle.position, particle.color);
+		auto position = to_sf(particle.position);
+		if(visible_area.contains(position)) draw_point(position, to_sf(particle.color));
 	}
 
-	print_framerate(framerate);
-
-	window.display();
+	finish_frame(framerate);
 }
 
 void Display::handle_events() {
+	const float zoom_step = 1.2;
+	const float key_move_fraction = 0.1;
+
 	sf::Event event;
 	while(window.pollEvent(event)) {
 		if(event.type == sf::Event::Closed) window.close();
+
+		else if(event.type == sf::Event::MouseWheelScrolled) {
+			auto pixel = sf::Vector2i(event.mouseWheelScroll.x, event.mouseWheelScroll.y);
+			zoom_camera(pixel, std::pow(zoom_step, -event.mouseWheelScroll.delta));
+		}
+
+		else if(event.type == sf::Event::MouseButtonPressed && event.mouseButton.button == sf::Mouse::Left) {
+			dragging = true;
+			last_mouse_position = sf::Vector2i(event.mouseButton.x, event.mouseButton.y);
+		}
+
+		else if(event.type == sf::Event::MouseButtonReleased && event.mouseButton.button == sf::Mouse::Left) {
+			dragging = false;
+		}
+
+		else if(event.type == sf::Event::MouseMoved && dragging) {
+			auto mouse_position = sf::Vector2i(event.mouseMove.x, event.mouseMove.y);
+			move_camera(last_mouse_position, mouse_position);
+			last_mouse_position = mouse_position;
+		}
+
+		else if(event.type == sf::Event::KeyPressed) {
+			auto step = camera.getSize() * key_move_fraction;
+			switch(event.key.code) {
+				case sf::Keyboard::Left: camera.move(-step.x, 0); break;
+				case sf::Keyboard::Right: camera.move(step.x, 0); break;
+				case sf::Keyboard::Up: camera.move(0, -step.y); break;
+				case sf::Keyboard::Down: camera.move(0, step.y); break;
+				case sf::Keyboard::Home: reset_camera(); break;
+				case sf::Keyboard::L: lod_enabled = !lod_enabled; break;
+				case sf::Keyboard::H: load_shown = !load_shown; break;
+				default: break;
+			}
+		}
 	}
 }
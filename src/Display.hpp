@@ -1,24 +1,83 @@
 #pragma once
 
+#include <vector>
+#include <chrono>
 #include <SFML/Graphics.hpp>
 #include "ParticleGrid.hpp"
 
-#define POINT_RADIUS 2
-
-
 class Display {
+public:
+	// how particles are drawn, from the nicest to the cheapest; see set_detail()
+	enum class Detail { Hexagons, Dots, Blobs };
+
+private:
 	sf::RenderWindow window;
 	sf::Font font;
 	float point_radius;
 
+	// kept between frames so that drawing doesn't allocate
+	sf::CircleShape point;
+	sf::Text framerate_text;
+	// the text is only changed a couple of times a second, it's unreadable otherwise anyway
+	std::chrono::steady_clock::time_point framerate_text_updated;
+
+	// the part of the world that's shown in the window
+	sf::View camera;
+	sf::Vector2f world_size;
+	bool dragging;
+	sf::Vector2i last_mouse_position;
+
+	// level of detail: when there's less than lod_pixels_per_particle pixels of the window
+	// for every visible particle, grid cells are drawn as blobs instead of particles.
+	// Blobs are at least lod_min_blob_pixels wide; neighbouring cells are merged if needed
+	const float lod_pixels_per_particle = 4;
+	const float lod_min_blob_pixels = 4;
+	bool lod_enabled;
+	Detail detail;
+	sf::VertexArray blobs;
+	// with Detail::Dots all particles are squares in a single draw call
+	sf::VertexArray dots;
+
+	// load overlay, switched with H: cells coloured by how many pairs of particles the force loop
+	// looked at in them, and a bar for every thread showing how much of the force loop it was busy for
+	const float load_bar_width = 200;
+	const float load_bar_height = 8;
+	bool load_shown;
+	std::vector<std::uint32_t> load_cell_pairs;
+	std::vector<float> load_thread_busy_ms;
+	sf::VertexArray load_quads;
+	// every color seen so far is a species; particle counts of every blob, per species and in total
+	std::vector<sf::Color> species_colors;
+	std::vector<std::vector<int>> block_species_counts;
+	std::vector<int> block_totals;
+	// species_colors index of every species of the grid but the last
+	std::vector<std::size_t> display_species;
+
 	void draw_point(sf::Vector2f pos, sf::Color color);
+	void add_dot(sf::Vector2f pos, sf::Color color);
+	void draw_blobs(const ParticleGrid& particles, sf::FloatRect area);
+	void add_quad(sf::Vector2f corner, sf::Vector2f size, sf::Color color);
+	void draw_load(const ParticleGrid& particles, sf::FloatRect area);
+	std::size_t species_of(sf::Color color);
+	float pixels_per_unit() const;
 	void print_framerate(int framerate);
+	void finish_frame(int framerate);
+
+	void reset_camera();
+	void zoom_camera(sf::Vector2i pixel, float factor);
+	void move_camera(sf::Vector2i from_pixel, sf::Vector2i to_pixel);
+	sf::FloatRect get_visible_area() const;
 
 public:
-	Display(int width, int height, std::string title, int framerate);
+	Display(sf::Vector2i window_size, sf::Vector2i world_size, std::string title, int framerate);
 
 	const sf::RenderWindow& get_window() const;
 	bool window_is_open() const;
+	// Hexagons by default; with Blobs the grid cells are drawn as blobs however far the camera is zoomed in
+	void set_detail(Detail detail);
+	bool load_overlay_shown() const;
+	// what the overlay shows; see Simulation::get_cell_pairs() and Simulation::get_thread_busy_ms()
+	void set_load(const std::vector<std::uint32_t>& cell_pairs, const std::vector<float>& thread_busy_ms);
 
 	void draw_window(const ParticleGrid& particles, int framerate);
 	void draw_window(const std::vector<Particle>& particles, int framerate);
@@ -0,0 +1,32 @@
+#include "Ensemble.hpp"
+
+Ensemble::Ensemble(const Recipe& recipe, int size, std::uint32_t first_seed, bool cpu_is_big_endian) {
+	simulations.reserve(size);
+	for(int i=0; i<size; ++i) add(recipe, first_seed + i, cpu_is_big_endian);
+}
+
+void Ensemble::add(const Recipe& recipe, std::uint32_t seed, bool cpu_is_big_endian) {
+	simulations.emplace_back(recipe, 0, cpu_is_big_endian, seed);
+}
+
+std::size_t Ensemble::size() const {
+	return simulations.size();
+}
+
+const std::vector<Simulation>& Ensemble::get_simulations() const {
+	return simulations;
+}
+
+void Ensemble::update(int steps, const std::function<void(std::size_t)>& on_finished) {
+	// dynamic because simulations of different recipes can take very different time;
+	// every Simulation::update in here sees it's nested and stays on its thread
+	#pragma omp parallel for schedule(dynamic, 1)
+	for(int i=0; i<static_cast<int>(simulations.size()); ++i) {
+		simulations[i].update(steps);
+
+		if(on_finished) {
+			#pragma omp critical
+			on_finished(i);
+		}
+	}
+}
@@ -0,0 +1,32 @@
+#pragma once
+
+#include <vector>
+#include <cstdint>
+#include <functional>
+#include "Simulation.hpp"
+#include "Recipe.hpp"
+
+/* Many independent simulations stepped together.
+ * A small simulation can't keep many cores busy on its own (the force loop is too short
+ * and sorting is serial), so instead of splitting every simulation over the threads,
+ * each thread takes whole simulations. Throughput then scales with the number
+ * of simulations rather than their size.
+ */
+
+class Ensemble {
+	std::vector<Simulation> simulations;
+
+public:
+	Ensemble() = default;
+	// `size` runs of the same recipe, seeded with first_seed, first_seed + 1, ...
+	Ensemble(const Recipe& recipe, int size, std::uint32_t first_seed, bool cpu_is_big_endian);
+
+	void add(const Recipe& recipe, std::uint32_t seed, bool cpu_is_big_endian);
+
+	std::size_t size() const;
+	const std::vector<Simulation>& get_simulations() const;
+
+	// every simulation does `steps` steps, each on a single thread;
+	// `on_finished` gets the index of every simulation once it's done, one call at a time
+	void update(int steps, const std::function<void(std::size_t)>& on_finished = nullptr);
+};
@@ -0,0 +1,100 @@
+#include "FrameArena.hpp"
+#include <cstdint>
+#include <algorithm>
+
+FrameArena::FrameArena():
+	block(new char[initial_capacity]),
+	capacity(initial_capacity),
+	used(0),
+	overflow_bytes(0),
+	peak_bytes(0),
+	overflowed(false),
+	quiet_resets(0)
+{}
+
+void* FrameArena::do_allocate(std::size_t bytes, std::size_t alignment) {
+	auto address = reinterpret_cast<std::uintptr_t>(block.get()) + used;
+	auto padding = (alignment - address % alignment) % alignment;
+
+	if(used + padding + bytes <= capacity) {
+		used += padding + bytes;
+		peak_bytes = std::max(peak_bytes, used + overflow_bytes);
+		return reinterpret_cast<void*>(address + padding);
+	}
+
+	// new[] is aligned enough for anything but overaligned types
+	auto* memory = new char[bytes + alignment];
+	auto overflow_address = reinterpret_cast<std::uintptr_t>(memory);
+	auto* pointer = reinterpret_cast<void*>(overflow_address + (alignment - overflow_address % alignment) % alignment);
+	overflow.push_back(Overflow { std::unique_ptr<char[]>(memory), pointer, bytes + alignment });
+	overflow_bytes += bytes + alignment;
+	peak_bytes = std::max(peak_bytes, used + overflow_bytes);
+	overflowed = true;
+	return pointer;
+}
+
+void FrameArena::do_deallocate(void* pointer, std::size_t bytes, std::size_t) {
+	auto* start = static_cast<char*>(pointer);
+	if(start >= block.get() && start < block.get() + capacity) {
+		// the last allocation can be taken back right away, which keeps a loop
+		// that allocates and frees a vector every iteration from using up the arena;
+		// everything else in the block is only freed by reset()
+		if(start + bytes == block.get() + used) used = start - block.get();
+		return;
+	}
+
+	// there's only a handful of these, and a vector that grew past the block frees its old buffers here
+	for(auto& piece : overflow) {
+		if(piece.pointer != pointer) continue;
+		overflow_bytes -= piece.bytes;
+		std::swap(piece, overflow.back());
+		overflow.pop_back();
+		return;
+	}
+}
+
+bool FrameArena::do_is_equal(const std::pmr::memory_resource& other) const noexcept {
+	return this == &other;
+}
+
+void FrameArena::reset() {
+	used = 0;
+	overflow.clear();
+	overflow_bytes = 0;
+
+	auto peak = peak_bytes;
+	peak_bytes = 0;
+
+	if(overflowed) {
+		// room for everything this step needed at once, and then some
+		overflowed = false;
+		quiet_resets = 0;
+		capacity = peak * 2;
+		block.reset(new char[capacity]);
+		return;
+	}
+
+	if(capacity <= initial_capacity || peak >= capacity / 4) {
+		quiet_resets = 0;
+		return;
+	}
+
+	if(++quiet_resets < shrink_after) return;
+	quiet_resets = 0;
+	capacity = std::max(capacity / 2, initial_capacity);
+	block.reset(new char[capacity]);
+}
+
+namespace frame_arena {
+	namespace {
+		thread_local FrameArena arena;
+	}
+
+	std::pmr::memory_resource* local() {
+		return &arena;
+	}
+
+	void reset_local() {
+		arena.reset();
+	}
+}
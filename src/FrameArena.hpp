@@ -0,0 +1,56 @@
+#pragma once
+
+#include <memory>
+#include <memory_resource>
+#include <vector>
+#include <cstddef>
+
+/* Bump allocator for the short lived allocations of a step or a frame
+ * (like the ranges of ParticleGrid::get_ranges_in()). Every thread has its own,
+ * so no locking; everything it handed out is freed at once with reset_local(),
+ * except that freeing the most recent allocation takes it back immediately.
+ * When a step needs more than the arena has, the extra comes from the heap (and goes back
+ * to it as soon as it's freed) and the arena grows on the next reset, so after a few steps
+ * nothing hits the heap anymore. An arena that stays mostly unused for a while shrinks again,
+ * so a single heavy step doesn't keep its memory for good.
+ */
+
+class FrameArena : public std::pmr::memory_resource {
+	const std::size_t initial_capacity = 64 * 1024;
+	// resets in a row that used less than a quarter of the block before it's halved
+	const int shrink_after = 64;
+
+	struct Overflow {
+		std::unique_ptr<char[]> memory;
+		void* pointer;
+		std::size_t bytes;
+	};
+
+	std::unique_ptr<char[]> block;
+	std::size_t capacity;
+	std::size_t used;
+	// what didn't fit in the block and hasn't been freed yet
+	std::vector<Overflow> overflow;
+	std::size_t overflow_bytes;
+	// most of the block and the overflow in use at the same time since the last reset
+	std::size_t peak_bytes;
+	bool overflowed;
+	int quiet_resets;
+
+protected:
+	void* do_allocate(std::size_t bytes, std::size_t alignment) override;
+	void do_deallocate(void* pointer, std::size_t bytes, std::size_t alignment) override;
+	bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override;
+
+public:
+	FrameArena();
+
+	void reset();
+};
+
+namespace frame_arena {
+	// the arena of the calling thread
+	std::pmr::memory_resource* local();
+	// frees everything allocated from the calling thread's arena
+	void reset_local();
+}
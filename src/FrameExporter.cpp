@@ -0,0 +1,111 @@
+#include "FrameExporter.hpp"
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <filesystem>
+
+#if __has_include(<omp.h>)
+	#define OMP_PRESENT
+	#include <omp.h>
+#endif
+
+FrameExporter::FrameExporter(std::string_view recording_path, std::string_view directory, Format format, bool cpu_is_big_endian):
+	replayer(recording_path, cpu_is_big_endian),
+	rasterizer(replayer.get_board_size(), {max_image_width, max_image_height}),
+	directory(directory),
+	format(format)
+{
+	if(!replayer.is_good()) {
+		errors += "Can't open file: " + std::string(recording_path) + "\n";
+		return;
+	}
+
+	if(writes_to_stdout()) return;
+
+	std::error_code error;
+	std::filesystem::create_directories(this->directory, error);
+	if(error) errors += "Can't create directory: " + this->directory + "\n";
+}
+
+const std::string& FrameExporter::get_errors() const {
+	return errors;
+}
+
+sf::Vector2u FrameExporter::get_image_size() const {
+	return rasterizer.get_image_size();
+}
+
+bool FrameExporter::writes_to_stdout() const {
+	return format == Raw && directory == "-";
+}
+
+std::string FrameExporter::frame_path(int frame) const {
+	std::ostringstream path;
+	path << directory << "/frame" << std::setw(6) << std::setfill('0') << frame << ".png";
+	return path.str();
+}
+
+int FrameExporter::run(int threads) {
+	if(!errors.empty()) return 0;
+
+	#ifdef OMP_PRESENT
+		if(threads != 0) omp_set_num_threads(threads);
+		const int batch_size = omp_get_max_threads() * 2;
+	#else
+		(void)threads;
+		const int batch_size = 1;
+	#endif
+
+	std::ofstream raw_file;
+	if(format == Raw && !writes_to_stdout()) {
+		raw_file.open(directory + "/frames.rgba", std::ios::binary);
+		if(!raw_file.good()) {
+			errors += "Can't open file: " + directory + "/frames.rgba\n";
+			return 0;
+		}
+	}
+	std::ostream& raw_out = writes_to_stdout() ? std::cout : raw_file;
+
+	// reading is sequential, so a batch of frames is read first and then drawn all at once
+	std::vector<std::vector<Particle>> frames(batch_size);
+	std::vector<std::vector<sf::Uint8>> images(batch_size);
+	int exported = 0;
+	bool failed = false;
+
+	while(!failed) {
+		int frame_count = 0;
+		while(frame_count < batch_size && replayer.next_frame()) {
+			frames[frame_count] = replayer.get_particles();
+			++frame_count;
+		}
+		if(frame_count == 0) break;
+
+		#pragma omp parallel for schedule(dynamic, 1)
+		for(int i=0; i<frame_count; ++i) {
+			rasterizer.draw(frames[i], images[i]);
+
+			if(format == Png) {
+				sf::Image image;
+				image.create(get_image_size().x, get_image_size().y, images[i].data());
+				if(!image.saveToFile(frame_path(exported + i))) {
+					#pragma omp critical
+					failed = true;
+				}
+			}
+		}
+
+		// raw frames have to be written in order
+		if(format == Raw) {
+			for(int i=0; i<frame_count; ++i) {
+				raw_out.write(reinterpret_cast<const char*>(images[i].data()), images[i].size());
+			}
+			if(!raw_out.good()) failed = true;
+		}
+
+		exported += frame_count;
+	}
+
+	if(failed) errors += "Failed to write frames to: " + directory + "\n";
+	return exported;
+}
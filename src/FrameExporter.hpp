@@ -0,0 +1,45 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <SFML/Graphics.hpp>
+#include "Replayer.hpp"
+#include "Rasterizer.hpp"
+
+/* Turns a recording into images without opening a window.
+ * Frames are read in batches and every frame of a batch is drawn (and saved) on its own thread.
+ *
+ * Png: `directory/frame000000.png`, `directory/frame000001.png`, ...
+ * Raw: all frames as raw RGBA one after another in `directory/frames.rgba`,
+ *      or on the standard output when `directory` is `-`, e.g. for
+ *      `ffmpeg -f rawvideo -pix_fmt rgba -s WxH -r 60 -i - out.mp4`
+ */
+
+class FrameExporter {
+public:
+	enum Format { Png, Raw };
+
+	// largest exported image; larger worlds are scaled down
+	static const unsigned max_image_width = 1920;
+	static const unsigned max_image_height = 1080;
+
+private:
+	Replayer replayer;
+	Rasterizer rasterizer;
+	std::string directory;
+	Format format;
+	std::string errors;
+
+	std::string frame_path(int frame) const;
+
+public:
+	FrameExporter(std::string_view recording_path, std::string_view directory, Format format, bool cpu_is_big_endian);
+
+	const std::string& get_errors() const;
+	sf::Vector2u get_image_size() const;
+	bool writes_to_stdout() const;
+
+	// returns the number of exported frames; errors end up in get_errors()
+	int run(int threads);
+};
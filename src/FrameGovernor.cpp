@@ -0,0 +1,141 @@
+#include "FrameGovernor.hpp"
+#include <cmath>
+#include <string>
+#include <algorithm>
+
+namespace {
+	const char* detail_name(Display::Detail detail) {
+		switch(detail) {
+			case Display::Detail::Hexagons: return "hexagons";
+			case Display::Detail::Dots: return "dots";
+			case Display::Detail::Blobs: return "blobs";
+		}
+		return "";
+	}
+
+	// one decimal place is plenty and doesn't touch the formatting of the stream
+	double rounded(double ms) {
+		return std::round(ms * 10) / 10;
+	}
+}
+
+FrameGovernor::FrameGovernor(int target_fps, int max_steps_per_frame, std::ostream& log):
+	budget_ms(1000.0 / (target_fps > 0 ? target_fps : 60)),
+	max_steps(std::max(max_steps_per_frame, 1)),
+	steps_adjustable(max_steps_per_frame > 0),
+	log(log),
+	steps_per_frame(max_steps),
+	detail(Display::Detail::Hexagons),
+	out_of_options(false),
+	window_frames(0),
+	frames_per_decision(std::max((target_fps > 0 ? target_fps : 60) / 2, 1)),
+	phase_ms{},
+	window_steps(0),
+	draw_ms_at{}
+{}
+
+void FrameGovernor::add_time(Phase phase, duration time) {
+	phase_ms[static_cast<int>(phase)] += std::chrono::duration<double, std::milli>(time).count();
+}
+
+void FrameGovernor::end_frame(int steps) {
+	++window_frames;
+	window_steps += steps;
+	if(window_frames < frames_per_decision) return;
+
+	decide();
+
+	window_frames = 0;
+	window_steps = 0;
+	phase_ms.fill(0);
+}
+
+double FrameGovernor::average(Phase phase) const {
+	return phase_ms[static_cast<int>(phase)] / window_frames;
+}
+
+void FrameGovernor::decide() {
+	double step_ms = window_steps > 0 ? phase_ms[static_cast<int>(Phase::Update)] / window_steps : 0;
+	draw_ms_at[static_cast<int>(detail)] = average(Phase::Draw);
+
+	// when the simulation fills the frame by itself it only has to have room for one step
+	double frame_ms = 0;
+	for(int phase = 0; phase < phase_count; ++phase) frame_ms += phase_ms[phase] / window_frames;
+	if(!steps_adjustable) frame_ms += step_ms - average(Phase::Update);
+
+	if(frame_ms <= budget_ms) {
+		out_of_options = false;
+		if(frame_ms < budget_ms * refill_fraction) take_back(frame_ms, step_ms);
+	} else if(!give_up(frame_ms, step_ms) && !out_of_options) {
+		log << "frame governor: " << rounded(frame_ms) << " ms of " << rounded(budget_ms)
+		    << " ms per frame with nothing left to give up; the program will run slower\n";
+		out_of_options = true;
+	}
+}
+
+bool FrameGovernor::give_up(double frame_ms, double step_ms) {
+	// whatever saves the most goes first; saving of drawing is a guess
+	double steps_saving = 0;
+	int fewer_steps = steps_per_frame;
+	if(steps_adjustable && steps_per_frame > 1 && step_ms > 0) {
+		int over_by = std::ceil((frame_ms - budget_ms * refill_fraction) / step_ms);
+		fewer_steps = std::max(steps_per_frame - std::max(over_by, 1), 1);
+		steps_saving = (steps_per_frame - fewer_steps) * step_ms;
+	}
+	double draw_saving = detail != Display::Detail::Blobs ? average(Phase::Draw) / 2 : 0;
+
+	if(steps_saving <= 0 && draw_saving <= 0) return false;
+
+	if(steps_saving >= draw_saving) {
+		report(frame_ms, step_ms, "steps per frame", std::to_string(steps_per_frame), std::to_string(fewer_steps));
+		steps_per_frame = fewer_steps;
+	} else {
+		auto cheaper = static_cast<Display::Detail>(static_cast<int>(detail) + 1);
+		report(frame_ms, step_ms, "drawing", detail_name(detail), detail_name(cheaper));
+		detail = cheaper;
+	}
+	return true;
+}
+
+bool FrameGovernor::take_back(double frame_ms, double step_ms) {
+	double room = budget_ms * refill_fraction - frame_ms;
+
+	// drawing first since it's what people look at, then speed
+	if(detail != Display::Detail::Hexagons) {
+		auto better = static_cast<Display::Detail>(static_cast<int>(detail) - 1);
+		if(draw_ms_at[static_cast<int>(better)] - average(Phase::Draw) < room) {
+			report(frame_ms, step_ms, "drawing", detail_name(detail), detail_name(better));
+			detail = better;
+			return true;
+		}
+	}
+
+	if(steps_adjustable && steps_per_frame < max_steps && step_ms > 0) {
+		int more_steps = std::min(steps_per_frame + static_cast<int>(room / step_ms), max_steps);
+		if(more_steps > steps_per_frame) {
+			report(frame_ms, step_ms, "steps per frame", std::to_string(steps_per_frame), std::to_string(more_steps));
+			steps_per_frame = more_steps;
+			return true;
+		}
+	}
+
+	return false;
+}
+
+void FrameGovernor::report(double frame_ms, double step_ms, const char* what, const std::string& from, const std::string& to) {
+	log << "frame governor: " << rounded(frame_ms) << " ms of " << rounded(budget_ms) << " ms per frame"
+	    << " (events " << rounded(average(Phase::Events))
+	    << ", update " << rounded(average(Phase::Update)) << " at " << rounded(step_ms) << " per step"
+	    << ", record " << rounded(average(Phase::Record))
+	    << ", draw " << rounded(average(Phase::Draw))
+	    << ", other " << rounded(average(Phase::Other)) << "); "
+	    << what << " " << from << " -> " << to << "\n";
+}
+
+int FrameGovernor::get_steps_per_frame() const {
+	return steps_per_frame;
+}
+
+Display::Detail FrameGovernor::get_detail() const {
+	return detail;
+}
@@ -0,0 +1,67 @@
+#pragma once
+
+#include <array>
+#include <chrono>
+#include <string>
+#include <ostream>
+#include "Display.hpp"
+
+/* Keeps frames within the time given by the target framerate when the simulation gets too heavy.
+ * main() tells it how long every phase of the frame took; every half a second it looks at the averages
+ * and either gives something up (fewer steps per frame, cheaper drawing)
+ * or takes back something it gave up earlier, if the frame has room for it.
+ * Recording is timed but never thinned out: recordings don't know how many steps a frame is,
+ * so dropping frames from them would make replays run faster.
+ * Every such decision is written to the log along with the costs it was based on.
+ */
+
+class FrameGovernor {
+public:
+	enum class Phase { Events, Update, Record, Draw, Other };
+
+private:
+	static const int phase_count = 5;
+	using duration = std::chrono::steady_clock::duration;
+
+	// frames over the budget give something up; frames under refill_fraction of it take something back
+	// if it's expected to still fit under that, which leaves room for the estimate being a bit off
+	const double refill_fraction = 0.9;
+
+	double budget_ms;
+	int max_steps;
+	// false with `--steps-per-frame auto`, where the simulation fills the frame on its own
+	bool steps_adjustable;
+	std::ostream& log;
+
+	int steps_per_frame;
+	Display::Detail detail;
+	// set once everything was given up and frames are still too long, so that it's only said once
+	bool out_of_options;
+
+	// sums over the frames since the last decision
+	int window_frames;
+	int frames_per_decision;
+	std::array<double, phase_count> phase_ms;
+	int window_steps;
+	// what drawing cost per frame the last time it was done at every level of detail,
+	// so it's known whether going back to it fits
+	std::array<double, 3> draw_ms_at;
+
+	double average(Phase phase) const;
+	void decide();
+	// both return false when there's nothing left to change
+	bool give_up(double frame_ms, double step_ms);
+	bool take_back(double frame_ms, double step_ms);
+	void report(double frame_ms, double step_ms, const char* what, const std::string& from, const std::string& to);
+
+public:
+	// `max_steps_per_frame` of 0 means the steps are left to Simulation::update_for()
+	FrameGovernor(int target_fps, int max_steps_per_frame, std::ostream& log);
+
+	void add_time(Phase phase, duration time);
+	// `steps` done in this frame; may change the settings below
+	void end_frame(int steps);
+
+	int get_steps_per_frame() const;
+	Display::Detail get_detail() const;
+};
@@ -0,0 +1,67 @@
+#include "Metrics.hpp"
+#include <cmath>
+#include <algorithm>
+
+Metrics::Metrics(const ParticleGrid::ParticleVector& particles, core::Vector2i board_size):
+	mean_speed(0),
+	spatial_entropy(0),
+	cluster_count(0),
+	score(0)
+{
+	if(particles.empty()) return;
+
+	const int bin_count = bins_per_side * bins_per_side;
+	std::vector<int> bins(bin_count, 0);
+
+	double speed_sum = 0;
+	for(const auto& particle : particles) {
+		speed_sum += std::sqrt(
+				particle.velocity.x * particle.velocity.x +
+				particle.velocity.y * particle.velocity.y);
+
+		int bin_x = std::clamp(static_cast<int>(particle.position.x / board_size.x * bins_per_side), 0, bins_per_side - 1);
+		int bin_y = std::clamp(static_cast<int>(particle.position.y / board_size.y * bins_per_side), 0, bins_per_side - 1);
+		++bins[bin_y * bins_per_side + bin_x];
+	}
+	mean_speed = speed_sum / particles.size();
+
+	double entropy = 0;
+	for(int count : bins) {
+		if(count == 0) continue;
+		double p = static_cast<double>(count) / particles.size();
+		entropy -= p * std::log(p);
+	}
+	spatial_entropy = entropy / std::log(static_cast<double>(bin_count));
+
+	// flood fill over dense bins
+	double dense_threshold = 2.0 * particles.size() / bin_count;
+	std::vector<bool> visited(bin_count, false);
+	std::vector<int> stack;
+
+	for(int start = 0; start < bin_count; ++start) {
+		if(visited[start] || bins[start] <= dense_threshold) continue;
+
+		++cluster_count;
+		stack.push_back(start);
+		visited[start] = true;
+
+		while(!stack.empty()) {
+			int bin = stack.back();
+			stack.pop_back();
+
+			int x = bin % bins_per_side;
+			int y = bin / bins_per_side;
+			const int neighbours[4][2] = { {x - 1, y}, {x + 1, y}, {x, y - 1}, {x, y + 1} };
+
+			for(const auto& neighbour : neighbours) {
+				if(neighbour[0] < 0 || neighbour[1] < 0 || neighbour[0] >= bins_per_side || neighbour[1] >= bins_per_side) continue;
+				int next = neighbour[1] * bins_per_side + neighbour[0];
+				if(visited[next] || bins[next] <= dense_threshold) continue;
+				visited[next] = true;
+				stack.push_back(next);
+			}
+		}
+	}
+
+	score = cluster_count * (1 - spatial_entropy);
+}
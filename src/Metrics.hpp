@@ -0,0 +1,23 @@
+#pragma once
+
+#include <vector>
+#include "CoreTypes.hpp"
+#include "ParticleGrid.hpp"
+
+/* Cheap summary of what a simulation looks like, used to rank runs without looking at them.
+ * The board is divided into bins_per_side x bins_per_side bins and particles are counted in each.
+ */
+
+struct Metrics {
+	static const int bins_per_side = 32;
+
+	float mean_speed;
+	// 0 when all particles are in one bin, 1 when they're spread evenly
+	float spatial_entropy;
+	// groups of neighbouring bins with over twice the average number of particles
+	int cluster_count;
+	// many distinct clusters on an otherwise empty board score high, uniform gas scores 0
+	float score;
+
+	Metrics(const ParticleGrid::ParticleVector& particles, core::Vector2i board_size);
+};
@@ -1,17 +1,19 @@
 #include "Particle.hpp"
 #include <iostream>
 
-Particle::Particle(sf::Vector2f position, sf::Vector2f velocity, sf::Color color):
+Particle::Particle(core::Vector2f position, core::Vector2f velocity, core::Color color, std::uint32_t id):
 	position(position),
 	velocity(velocity),
-	color(color)
+	color(color),
+	id(id)
 {}
 
 bool operator==(const Particle& left, const Particle& right) {
 	return 
 		left.position == right.position &&
 		left.velocity == right.velocity &&
-		left.color == right.color;
+		left.color == right.color &&
+		left.id == right.id;
 }
 
 bool operator!=(const Particle& left, const Particle& right) {
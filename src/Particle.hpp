@@ -1,13 +1,19 @@
 #pragma once
 
-#include <SFML/Graphics.hpp>
+#include <cstdint>
+#include "CoreTypes.hpp"
+
+// how big particles are drawn, in the window as well as by the frame export
+#define POINT_RADIUS 2
 
 struct Particle {
-	sf::Vector2f position;
-	sf::Vector2f velocity;
-	sf::Color color;
+	core::Vector2f position;
+	core::Vector2f velocity;
+	core::Color color;
+	// stays the same when the particle is moved around in ParticleGrid
+	std::uint32_t id;
 
-	Particle(sf::Vector2f position, sf::Vector2f velocity, sf::Color color);
+	Particle(core::Vector2f position, core::Vector2f velocity, core::Color color, std::uint32_t id = 0);
 };
 
 bool operator==(const Particle& left, const Particle& right);
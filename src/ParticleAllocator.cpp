@@ -0,0 +1,74 @@
+#include "ParticleAllocator.hpp"
+#include <new>
+#include <cstdint>
+
+#if __has_include(<sys/mman.h>)
+	#define MMAN_PRESENT
+	#include <sys/mman.h>
+#endif
+
+namespace particle_memory {
+	namespace {
+		HugePages mode = HugePages::None;
+
+		std::size_t round_up(std::size_t bytes) {
+			return (bytes + huge_page_size - 1) / huge_page_size * huge_page_size;
+		}
+
+		bool uses_huge_pages(std::size_t bytes) {
+			#ifdef MMAN_PRESENT
+				return mode != HugePages::None && bytes >= huge_page_size;
+			#else
+				(void)bytes;
+				return false;
+			#endif
+		}
+	}
+
+	void set_huge_pages(HugePages huge_pages) {
+		mode = huge_pages;
+	}
+
+	void* allocate(std::size_t bytes) {
+		if(!uses_huge_pages(bytes)) return ::operator new(bytes);
+
+		#ifdef MMAN_PRESENT
+			auto size = round_up(bytes);
+
+			// mapped memory isn't touched until it's written to, so first touch placement still works
+			if(mode == HugePages::Explicit) {
+				void* memory = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+				if(memory != MAP_FAILED) return memory;
+			}
+
+			// over-allocate to get a huge page aligned start, then give the ends back
+			auto mapped_size = size + huge_page_size;
+			void* mapped = mmap(nullptr, mapped_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+			if(mapped == MAP_FAILED) throw std::bad_alloc();
+
+			auto address = reinterpret_cast<std::uintptr_t>(mapped);
+			auto aligned = round_up(address);
+			if(aligned > address) munmap(mapped, aligned - address);
+			auto tail = address + mapped_size - (aligned + size);
+			if(tail > 0) munmap(reinterpret_cast<void*>(aligned + size), tail);
+
+			#ifdef MADV_HUGEPAGE
+				madvise(reinterpret_cast<void*>(aligned), size, MADV_HUGEPAGE);
+			#endif
+			return reinterpret_cast<void*>(aligned);
+		#else
+			return ::operator new(bytes);
+		#endif
+	}
+
+	void deallocate(void* pointer, std::size_t bytes) {
+		if(!uses_huge_pages(bytes)) {
+			::operator delete(pointer);
+			return;
+		}
+
+		#ifdef MMAN_PRESENT
+			munmap(pointer, round_up(bytes));
+		#endif
+	}
+}
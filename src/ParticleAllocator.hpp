@@ -0,0 +1,69 @@
+#pragma once
+
+#include <memory>
+#include <utility>
+#include <type_traits>
+#include <cstddef>
+
+/* std::allocator, except that `resize()` and friends leave new elements uninitialized
+ * instead of value initializing them. Memory pages end up on the NUMA node of the thread
+ * that first writes to them, and with this that's the thread that fills them in
+ * rather than whichever one happened to resize the vector.
+ * Only for types that are fine being left uninitialized until they're assigned.
+ *
+ * Large buffers can also be backed by huge pages (see particle_memory::set_huge_pages()),
+ * so that walking over millions of particles doesn't keep missing the TLB.
+ */
+
+namespace particle_memory {
+	enum class HugePages {
+		// plain new/delete
+		None,
+		// 2 MiB aligned memory the kernel is asked to back with transparent huge pages
+		Transparent,
+		// MAP_HUGETLB; needs huge pages reserved in /proc/sys/vm/nr_hugepages, falls back to Transparent
+		Explicit
+	};
+
+	// buffers smaller than that never use huge pages
+	const std::size_t huge_page_size = 2 * 1024 * 1024;
+
+	// must be called before anything is allocated
+	void set_huge_pages(HugePages huge_pages);
+	void* allocate(std::size_t bytes);
+	void deallocate(void* pointer, std::size_t bytes);
+}
+
+template<typename T>
+class ParticleAllocator {
+	static_assert(std::is_trivially_copyable_v<T> && std::is_trivially_destructible_v<T>,
+			"elements are assigned to without being constructed first");
+
+public:
+	using value_type = T;
+
+	ParticleAllocator() = default;
+	template<typename U>
+	ParticleAllocator(const ParticleAllocator<U>&) noexcept {}
+
+	T* allocate(std::size_t count) {
+		return static_cast<T*>(particle_memory::allocate(count * sizeof(T)));
+	}
+
+	void deallocate(T* pointer, std::size_t count) noexcept {
+		particle_memory::deallocate(pointer, count * sizeof(T));
+	}
+
+	template<typename U>
+	void construct(U*) noexcept {}
+
+	template<typename U, typename... Args>
+	void construct(U* pointer, Args&&... args) {
+		::new(static_cast<void*>(pointer)) U(std::forward<Args>(args)...);
+	}
+};
+
+template<typename T, typename U>
+bool operator==(const ParticleAllocator<T>&, const ParticleAllocator<U>&) { return true; }
+template<typename T, typename U>
+bool operator!=(const ParticleAllocator<T>&, const ParticleAllocator<U>&) { return false; }
@@ -1,37 +1,91 @@
 #include "ParticleGrid.hpp"
 #include <cmath>
+#include <algorithm>
+#include "FrameArena.hpp"
 
-ParticleGrid::ParticleGrid(sf::Vector2i window_size, int cell_resolution):
+namespace {
+	// puts a zero bit between every two bits of `value`
+	std::uint64_t spread_bits(std::uint32_t value) {
+		std::uint64_t bits = value;
+		bits = (bits | (bits << 16)) & 0x0000ffff0000ffff;
+		bits = (bits | (bits << 8)) & 0x00ff00ff00ff00ff;
+		bits = (bits | (bits << 4)) & 0x0f0f0f0f0f0f0f0f;
+		bits = (bits | (bits << 2)) & 0x3333333333333333;
+		bits = (bits | (bits << 1)) & 0x5555555555555555;
+		return bits;
+	}
+
+	// joins it to the last range if they're adjacent
+	void add_range(std::pair<std::size_t, std::size_t> range, ParticleGrid::Ranges& ranges) {
+		if(range.first == range.second) return;
+		if(!ranges.empty() && ranges.back().second == range.first) ranges.back().second = range.second;
+		else ranges.push_back(range);
+	}
+
+	core::Vector2i grid_size_for(core::Vector2i board_size, float cell_size) {
+		return {
+			std::max(1, static_cast<int>(std::ceil(board_size.x / cell_size))),
+			std::max(1, static_cast<int>(std::ceil(board_size.y / cell_size)))
+		};
+	}
+
+	// bits needed for numbers below `count`
+	int bits_for(int count) {
+		int bits = 0;
+		while((1 << bits) < count) ++bits;
+		return bits;
+	}
+}
+
+ParticleGrid::ParticleGrid(core::Vector2i window_size, int cell_resolution):
 	grid_size(cell_resolution, cell_resolution),
-	cell_size(window_size.x / cell_resolution, window_size.y / cell_resolution),
+	cell_size(
+			static_cast<float>(window_size.x) / cell_resolution,
+			static_cast<float>(window_size.y) / cell_resolution),
+	cell_index(CellIndex::Dense),
+	cell_order(CellOrder::Rows),
 	cell_positions((grid_size.x * grid_size.y), 0),
-	p1_is_new(false),
-	compare(grid_size.x, cell_size)
+	aggregates_kept(false),
+	spread_needed(false),
+	compare(grid_size, cell_size, cell_order)
 {}
 
-const std::vector<Particle>& ParticleGrid::get_particles() const {
-	if(p1_is_new) return particles2;
-	else return particles1;
+ParticleGrid::ParticleGrid(core::Vector2i board_size, float cell_size, CellIndex cell_index, CellOrder cell_order):
+	grid_size(grid_size_for(board_size, cell_size)),
+	cell_size(cell_size, cell_size),
+	cell_index(cell_index),
+	cell_order(cell_order),
+	aggregates_kept(false),
+	spread_needed(false),
+	compare(grid_size, this->cell_size, cell_order)
+{
+	if(cell_index == CellIndex::Dense) {
+		cell_positions.resize(compare.key_count(), 0);
+	}
 }
 
-const std::vector<Particle>& ParticleGrid::get_new_particles() const {
-	if(p1_is_new) return particles1;
-	else return particles2;
+std::uint64_t ParticleGrid::dense_key_count(
+		core::Vector2i board_size,
+		float cell_size,
+		CellOrder cell_order,
+		int species_count,
+		int levels
+) {
+	auto compare = CompareByGridCell(grid_size_for(board_size, cell_size), {cell_size, cell_size}, cell_order);
+	compare.species_count = species_count;
+	compare.levels = std::clamp(levels, 0, max_levels);
+	return compare.key_count();
 }
 
-std::vector<Particle>& ParticleGrid::get_mut_particles() {
-	if(p1_is_new) return particles2;
-	else return particles1;
+const ParticleGrid::ParticleVector& ParticleGrid::get_particles() const {
+	return particles;
 }
 
-std::vector<Particle>& ParticleGrid::get_mut_new_particles() {
-	if(p1_is_new) return particles1;
-	else return particles2;
+ParticleGrid::ParticleVector& ParticleGrid::get_mut_particles() {
+	return particles;
 }
 
 void ParticleGrid::insert(const Particle& particle) {
-	auto& particles = get_mut_particles();
-
 	auto it = particles.begin();
 	for(; it != particles.end(); ++it) {
 		if(compare(particle, *it)) break;
@@ -39,114 +93,538 @@ void ParticleGrid::insert(const Particle& particle) {
 
 	particles.insert(it, particle);
 
-	int cell_x = floor(particle.position.x / cell_size.x);
-	int cell_y = floor(particle.position.y / cell_size.y);
-	std::size_t cell_n = cell_y * grid_size.x + cell_x;
+	rebuild_indices_by_id();
+
+	if(cell_index == CellIndex::Sparse) {
+		rebuild_sparse_cells();
+		return;
+	}
+
+	std::size_t cell_n = compare.key(particle);
 
 	for(std::size_t i=0; i < cell_positions.size(); ++i) {
 		if(i > cell_n) ++cell_positions[i];
 	}
 }
 
-std::vector<std::pair<std::size_t, std::size_t>> ParticleGrid::get_ranges_in(
-		sf::FloatRect area
+void ParticleGrid::append(const Particle& particle) {
+	particles.push_back(particle);
+	set_index_of(particle.id, particles.size() - 1);
+}
+
+ParticleGrid::Ranges ParticleGrid::get_ranges_in(
+		core::FloatRect area,
+		int species,
+		int level
+) const {
+	Ranges res(frame_arena::local());
+	get_ranges_in(area, res, species, level);
+	return res;
+}
+
+void ParticleGrid::get_ranges_in(
+		core::FloatRect area,
+		Ranges& res,
+		int species,
+		int level
+) const {
+	res.clear();
+
+	level = std::min(level, compare.levels);
+	if(level > 0) {
+		add_level_ranges(area, species, level, res);
+		return;
+	}
+
+	auto first_cell = compare.cell_of({area.left, area.top});
+	auto last_cell = compare.cell_of({area.left + area.width, area.top + area.height});
+	std::size_t area_cells = std::size_t(last_cell.x - first_cell.x + 1) * (last_cell.y - first_cell.y + 1);
+
+	if(cell_order == CellOrder::Morton) {
+		// the curve can leave and come back into the area at almost every cell
+		res.reserve(area_cells);
+
+		// start from the smallest aligned square holding the whole area; for a neighbourhood
+		// query that's a few levels instead of the whole grid
+		int differ = (first_cell.x ^ last_cell.x) | (first_cell.y ^ last_cell.y);
+		int smallest_level = bits_for(differ + 1);
+		if(smallest_level <= compare.common_bits) {
+			int mask = ~((1 << smallest_level) - 1);
+			add_morton_ranges(first_cell, last_cell, {first_cell.x & mask, first_cell.y & mask}, smallest_level, species, res);
+			return;
+		}
+
+		// the padded grid is a row of squares of 2^common_bits cells along its longer side,
+		// one after another on the curve
+		int level = compare.common_bits;
+		bool along_x = compare.bits_x > compare.bits_y;
+		int first_square = (along_x ? first_cell.x : first_cell.y) >> level;
+		int last_square = (along_x ? last_cell.x : last_cell.y) >> level;
+
+		for(int square = first_square; square <= last_square; ++square) {
+			auto origin = along_x ? core::Vector2i(square << level, 0) : core::Vector2i(0, square << level);
+			add_morton_ranges(first_cell, last_cell, origin, level, species, res);
+		}
+		return;
+	}
+
+	// a range per row, or per cell with a single species
+	res.reserve(species == all_species ? last_cell.y - first_cell.y + 1 : area_cells);
+
+	// cells within a row are adjacent in the particle vector
+	// so every row of the area is a single range
+	for(int y = first_cell.y; y <= last_cell.y; ++y) {
+		std::uint64_t row_ord = static_cast<std::uint64_t>(grid_size.x) * y;
+		add_ord_range(row_ord + first_cell.x, row_ord + last_cell.x, species, res);
+	}
+}
+
+void ParticleGrid::add_morton_ranges(
+		core::Vector2i first_cell,
+		core::Vector2i last_cell,
+		core::Vector2i origin,
+		int level,
+		int species,
+		Ranges& ranges
 ) const {
-	float y_start = floor(area.top / cell_size.y) * cell_size.y;
-	std::size_t y_cells = ceil((area.height + area.top - y_start) / cell_size.y);
-
-	float x_start = floor(area.left / cell_size.x) * cell_size.x;
-	float x_cells = ceil((area.width + area.left - x_start) / cell_size.x);
-	float x_end = x_start + x_cells * cell_size.x;
-	
-	std::vector<std::pair<std::size_t, std::size_t>> res(y_cells, {0, 0});
-
-	float previous_y = -1;
-	std::size_t range_i = 0;
-
-	for(std::size_t i=0; i<cell_positions.size(); ++i) {
-		float current_y = (i / grid_size.x) * cell_size.y;
-		if(current_y < y_start) continue;
-
-		float current_x = (i % grid_size.x) * cell_size.x;
-		if(current_x >= x_start && current_x <= x_end) {
-			if(previous_y == -1) res[range_i].first = cell_positions[i];
-			else if(previous_y != current_y) {
-				res[range_i].second = cell_positions[i];
-				++range_i;
-				if(range_i < y_cells) res[range_i].first = cell_positions[i];
-				else break;
+	int size = 1 << level;
+	if(origin.x > last_cell.x || origin.y > last_cell.y) return;
+	if(origin.x + size <= first_cell.x || origin.y + size <= first_cell.y) return;
+
+	bool inside =
+		origin.x >= first_cell.x && origin.x + size - 1 <= last_cell.x &&
+		origin.y >= first_cell.y && origin.y + size - 1 <= last_cell.y;
+
+	// all cells of an aligned square are a single run of the curve
+	if(inside) {
+		auto first_ord = compare.cell_ord(origin);
+		add_ord_range(first_ord, first_ord + (std::uint64_t(1) << (2 * level)) - 1, species, ranges);
+		return;
+	}
+
+	// quarters in the order of the curve; x is the lower bit
+	int half = size / 2;
+	if(level == 1) {
+		auto first_ord = compare.cell_ord(origin);
+		for(int quarter = 0; quarter < 4; ++quarter) {
+			auto cell = origin + core::Vector2i(quarter & 1, quarter >> 1);
+			if(cell.x < first_cell.x || cell.x > last_cell.x || cell.y < first_cell.y || cell.y > last_cell.y) continue;
+			add_ord_range(first_ord + quarter, first_ord + quarter, species, ranges);
+		}
+		return;
+	}
+
+	add_morton_ranges(first_cell, last_cell, origin, level - 1, species, ranges);
+	add_morton_ranges(first_cell, last_cell, origin + core::Vector2i(half, 0), level - 1, species, ranges);
+	add_morton_ranges(first_cell, last_cell, origin + core::Vector2i(0, half), level - 1, species, ranges);
+	add_morton_ranges(first_cell, last_cell, origin + core::Vector2i(half, half), level - 1, species, ranges);
+}
+
+void ParticleGrid::add_ord_range(std::uint64_t first_ord, std::uint64_t last_ord, int species, Ranges& ranges) const {
+	if(species == all_species) {
+		add_range(get_key_range(compare.first_key(first_ord, 0), compare.first_key(last_ord + 1, 0)), ranges);
+		return;
+	}
+
+	// the particles of one species are split up by the other species in between
+	for(auto ord = first_ord; ord <= last_ord; ++ord) {
+		add_range(get_key_range(compare.first_key(ord, species), compare.first_key(ord, species + 1)), ranges);
+	}
+}
+
+void ParticleGrid::add_level_ranges(core::FloatRect area, int species, int level, Ranges& ranges) const {
+	// subcells of this level counted across the whole grid, worked out like CompareByGridCell::subcell_of()
+	// so that rounding can't put a particle in a subcell next to the one it's looked for in
+	int per_cell = 1 << level;
+	auto last_subcell = grid_size * per_cell - core::Vector2i(1, 1);
+	auto subcell_at = [&](core::Vector2f position) {
+		return core::Vector2i(
+				std::clamp(static_cast<int>(position.x * per_cell / cell_size.x), 0, last_subcell.x),
+				std::clamp(static_cast<int>(position.y * per_cell / cell_size.y), 0, last_subcell.y));
+	};
+	auto first = subcell_at({area.left, area.top});
+	auto last = subcell_at({area.left + area.width, area.top + area.height});
+
+	// a subcell of this level is a run of the smallest subcells
+	int finer_bits = 2 * (compare.levels - level);
+	int first_species = species == all_species ? 0 : species;
+	int last_species = species == all_species ? compare.species_count - 1 : species;
+	ranges.reserve((last.x - first.x + 1) * (last.y - first.y + 1) * (last_species - first_species + 1));
+
+	for(int y = first.y; y <= last.y; ++y) {
+		for(int x = first.x; x <= last.x; ++x) {
+			auto ord = compare.cell_ord(core::Vector2i(x >> level, y >> level));
+			std::uint64_t subcell = spread_bits(x & (per_cell - 1)) | (spread_bits(y & (per_cell - 1)) << 1);
+
+			for(int s = first_species; s <= last_species; ++s) {
+				auto key = compare.first_key(ord, s) + (subcell << finer_bits);
+				add_range(get_key_range(key, key + (std::uint64_t(1) << finer_bits)), ranges);
 			}
-			previous_y = current_y;
 		}
 	}
-	if(range_i < res.size() && res[range_i].second == 0) {
-		res[range_i].second = get_particles().size();
+}
+
+std::pair<std::size_t, std::size_t> ParticleGrid::get_key_range(std::uint64_t first_key, std::uint64_t end_key) const {
+	// only the occupied cells are known, so they're looked up one by one
+	if(cell_index == CellIndex::Sparse) {
+		std::pair<std::size_t, std::size_t> range = {0, 0};
+		for(auto key = first_key; key < end_key; ++key) {
+			auto key_range = sparse_cells.find(key);
+			if(key_range.first == key_range.second) continue;
+			if(range.first == range.second) range.first = key_range.first;
+			range.second = key_range.second;
+		}
+		return range;
 	}
 
-	return res;
+	std::size_t range_end = get_particles().size();
+	if(end_key < cell_positions.size()) range_end = cell_positions[end_key];
+	return {cell_positions[first_key], range_end};
+}
+
+core::Vector2i ParticleGrid::get_cell_of(core::Vector2f position) const {
+	return compare.cell_of(position);
+}
+
+std::pair<std::size_t, std::size_t> ParticleGrid::get_cell_range(core::Vector2i cell, int species) const {
+	auto ord = compare.cell_ord(cell);
+	if(species == all_species) return get_key_range(compare.first_key(ord, 0), compare.first_key(ord + 1, 0));
+	return get_key_range(compare.first_key(ord, species), compare.first_key(ord, species + 1));
 }
 
 void ParticleGrid::remove(const Particle& particle) {
-	auto& particles = get_mut_particles();
+	if(particle.id >= indices_by_id.size() || indices_by_id[particle.id] == no_index) return;
+	particles.erase(particles.begin() + indices_by_id[particle.id]);
+
+	rebuild_indices_by_id();
 
-	auto it = std::find(particles.begin(), particles.end(), particle);
-	particles.erase(it);
+	if(cell_index == CellIndex::Sparse) {
+		rebuild_sparse_cells();
+		return;
+	}
 
-	int cell_x = floor(particle.position.x / cell_size.x);
-	int cell_y = floor(particle.position.y / cell_size.y);
-	std::size_t cell_n = cell_y * grid_size.x + cell_x;
+	std::size_t cell_n = compare.key(particle);
 
 	for(std::size_t i=0; i < cell_positions.size(); ++i) {
 		if(i > cell_n) --cell_positions[i];
 	}
 }
 
+void ParticleGrid::queue_append(const Particle& particle) {
+	pending_appends.push_back(particle);
+}
+
+void ParticleGrid::queue_remove(std::size_t index) {
+	pending_removals.push_back(index);
+}
+
+void ParticleGrid::apply_pending_changes() {
+	if(pending_appends.empty() && pending_removals.empty()) return;
+
+	// a single pass moving the remaining particles over the removed ones
+	std::sort(pending_removals.begin(), pending_removals.end());
+	auto removal = pending_removals.begin();
+	std::size_t kept = 0;
+
+	for(std::size_t i=0; i<particles.size(); ++i) {
+		while(removal != pending_removals.end() && *removal < i) ++removal;
+		if(removal != pending_removals.end() && *removal == i) continue;
+		if(kept != i) particles[kept] = particles[i];
+		++kept;
+	}
+
+	particles.erase(particles.begin() + kept, particles.end());
+	auto capacity = particles.capacity();
+	particles.insert(particles.end(), pending_appends.begin(), pending_appends.end());
+	if(particles.capacity() != capacity) spread_needed = true;
+
+	pending_appends.clear();
+	pending_removals.clear();
+}
+
 void ParticleGrid::sort() {
-	auto& particles = get_mut_particles();
+	apply_pending_changes();
+
+	if(cell_index == CellIndex::Dense) {
+		counting_sort();
+		rebuild_indices_by_id();
+		return;
+	}
+
 	std::sort(particles.begin(), particles.end(), compare);
+	rebuild_indices_by_id();
+	rebuild_sparse_cells();
+}
 
-	// regenerate cell positions
-	int prev_cell_ord = -1;
+void ParticleGrid::counting_sort() {
+	// how many particles have every key, then where every key starts
+	sort_keys.resize(particles.size());
+	std::fill(cell_positions.begin(), cell_positions.end(), 0);
 	for(std::size_t i=0; i<particles.size(); ++i) {
-		int cell_x = particles[i].position.x / cell_size.x;
-		int cell_y = particles[i].position.y / cell_size.y;
-		int cell_ord = grid_size.x * cell_y + cell_x;
+		sort_keys[i] = compare.key(particles[i]);
+		++cell_positions[sort_keys[i]];
+	}
 
-		if(cell_ord != prev_cell_ord) {
-			for(int j = prev_cell_ord + 1; j <= cell_ord; ++j) {
-				cell_positions[j] = i;
-			}
+	// the same pass over the keys is all the aggregates need; subcells are left out of their index
+	if(aggregates_kept) {
+		aggregates.assign(compare.key_count() >> (2 * compare.levels), Aggregate { {0, 0}, 0 });
+		for(std::size_t i=0; i<particles.size(); ++i) {
+			auto& aggregate = aggregates[sort_keys[i] >> (2 * compare.levels)];
+			aggregate.centroid += particles[i].position;
+			++aggregate.count;
+		}
+		for(auto& aggregate : aggregates) {
+			if(aggregate.count > 0) aggregate.centroid /= static_cast<float>(aggregate.count);
+		}
+	}
+
+	std::size_t start = 0;
+	for(auto& position : cell_positions) {
+		auto count = position;
+		position = start;
+		start += count;
+	}
+
+	// the keys turn into where every particle goes; every position moves to the end of its key
+	// on the way, which is where the next key starts
+	for(auto& key : sort_keys) key = cell_positions[key]++;
+	std::copy_backward(cell_positions.begin(), cell_positions.end() - 1, cell_positions.end());
+	cell_positions.front() = 0;
+
+	// in place, a cycle at a time, so that there's no second vector of particles to sort into;
+	// particles that stay in their cell from step to step are already where they go
+	for(std::size_t i=0; i<particles.size(); ++i) {
+		while(sort_keys[i] != i) {
+			auto target = sort_keys[i];
+			std::swap(particles[i], particles[target]);
+			std::swap(sort_keys[i], sort_keys[target]);
 		}
+	}
+}
+
+void ParticleGrid::rebuild_sparse_cells() {
+	std::size_t occupied_keys = 0;
+	std::uint64_t prev_key = 0;
+	for(std::size_t i=0; i<particles.size(); ++i) {
+		auto key = compare.key(particles[i]);
+		if(i == 0 || key != prev_key) ++occupied_keys;
+		prev_key = key;
+	}
+
+	sparse_cells.reset(occupied_keys);
+
+	std::size_t key_start = 0;
+	for(std::size_t i=1; i<=particles.size(); ++i) {
+		auto start_key = compare.key(particles[key_start]);
+		if(i < particles.size() && compare.key(particles[i]) == start_key) continue;
+
+		sparse_cells.insert(start_key, key_start, i);
+		key_start = i;
+	}
+}
 
-		prev_cell_ord = cell_ord;
+void ParticleGrid::rebuild_indices_by_id() {
+	std::fill(indices_by_id.begin(), indices_by_id.end(), no_index);
+	for(std::size_t i=0; i<particles.size(); ++i) {
+		set_index_of(particles[i].id, i);
 	}
+}
+
+void ParticleGrid::set_index_of(std::uint32_t id, std::size_t index) {
+	if(id >= indices_by_id.size()) indices_by_id.resize(id + 1, no_index);
+	indices_by_id[id] = index;
+}
+
+const std::vector<std::uint32_t>& ParticleGrid::get_indices_by_id() const {
+	return indices_by_id;
+}
+
+ParticleGrid::CellIndex ParticleGrid::get_cell_index() const {
+	return cell_index;
+}
+
+ParticleGrid::CellOrder ParticleGrid::get_cell_order() const {
+	return cell_order;
+}
 
-	for(std::size_t i = prev_cell_ord+1; i < cell_positions.size(); ++i) {
-		cell_positions[i] = particles.size();
+void ParticleGrid::set_species(const std::vector<core::Color>& colors) {
+	int count = std::min<int>(colors.size(), max_species);
+	for(int species = 0; species < count; ++species) compare.species_colors[species] = colors[species].toInteger();
+	compare.species_count = count + 1;
+
+	if(cell_index == CellIndex::Dense) {
+		cell_positions.assign(compare.key_count(), 0);
 	}
+	sort();
+}
+
+int ParticleGrid::get_species_count() const {
+	return compare.species_count;
+}
+
+core::Color ParticleGrid::get_species_color(int species) const {
+	return core::Color(compare.species_colors[species]);
 }
 
-void ParticleGrid::swap_vecs() {
-	p1_is_new = !p1_is_new;
+void ParticleGrid::set_levels(int levels) {
+	if(cell_index == CellIndex::Sparse) return;
+
+	compare.levels = std::clamp(levels, 0, max_levels);
+	cell_positions.assign(compare.key_count(), 0);
+	sort();
+}
+
+int ParticleGrid::get_levels() const {
+	return compare.levels;
 }
 
-void ParticleGrid::init_new_with_old() {
-	get_mut_new_particles() = get_particles();
+void ParticleGrid::keep_aggregates(bool keep) {
+	if(cell_index == CellIndex::Sparse) return;
+
+	aggregates_kept = keep;
+	if(!keep) {
+		aggregates.clear();
+		return;
+	}
+	sort();
 }
 
-ParticleGrid::CompareByGridCell::CompareByGridCell(int grid_width, sf::Vector2f cell_size):
-	grid_width(grid_width),
-	cell_size(cell_size)
+const ParticleGrid::Aggregate& ParticleGrid::get_aggregate(core::Vector2i cell, int species) const {
+	return aggregates[compare.cell_ord(cell) * compare.species_count + species];
+}
+
+core::Vector2i ParticleGrid::get_grid_size() const {
+	return grid_size;
+}
+
+core::Vector2f ParticleGrid::get_cell_size() const {
+	return cell_size;
+}
+
+void ParticleGrid::spread_over_threads() {
+	#pragma omp parallel
+	spread_over_team();
+}
+
+void ParticleGrid::spread_over_team() {
+	#pragma omp single
+	placed_particles.resize(particles.size());
+
+	#pragma omp for schedule(static)
+	for(int i=0; i<static_cast<int>(particles.size()); ++i) {
+		placed_particles[i] = particles[i];
+	}
+
+	#pragma omp single
+	{
+		particles.swap(placed_particles);
+		ParticleVector().swap(placed_particles);
+		spread_needed = false;
+	}
+}
+
+bool ParticleGrid::needs_spreading() const {
+	return spread_needed;
+}
+
+ParticleGrid::CompareByGridCell::CompareByGridCell(core::Vector2i grid_size, core::Vector2f cell_size, CellOrder cell_order):
+	grid_size(grid_size),
+	cell_size(cell_size),
+	cell_order(cell_order),
+	bits_x(bits_for(grid_size.x)),
+	bits_y(bits_for(grid_size.y)),
+	common_bits(std::min(bits_x, bits_y)),
+	species_colors{},
+	species_count(1),
+	levels(0)
 {}
 
-bool ParticleGrid::CompareByGridCell::operator()(const Particle& p1, const Particle& p2) {
-	int cell1_x = p1.position.x / cell_size.x;
-	int cell1_y = p1.position.y / cell_size.y;
-	int cell1_ord = grid_width * cell1_y + cell1_x;
+bool ParticleGrid::CompareByGridCell::operator()(const Particle& p1, const Particle& p2) const {
+	if(cell_order == CellOrder::Rows) return key(p1) < key(p2);
+
+	// the same as comparing cell_ord() but without interleaving the bits:
+	// the coordinate with the highest differing bit decides, y winning ties because its bits come first
+	auto cell1 = cell_of(p1.position);
+	auto cell2 = cell_of(p2.position);
+	if(cell1 == cell2) {
+		if(species_count == 1 && levels == 0) return false;
+		auto species1 = species_of(p1.color);
+		auto species2 = species_of(p2.color);
+		if(species1 != species2) return species1 < species2;
+		return levels > 0 && subcell_of(p1.position, cell1) < subcell_of(p2.position, cell2);
+	}
 
-	int cell2_x = p2.position.x / cell_size.x;
-	int cell2_y = p2.position.y / cell_size.y;
-	int cell2_ord = grid_width * cell2_y + cell2_x;
+	int longer1 = bits_x > bits_y ? cell1.x : cell1.y;
+	int longer2 = bits_x > bits_y ? cell2.x : cell2.y;
+	if((longer1 >> common_bits) != (longer2 >> common_bits)) return longer1 < longer2;
+
+	unsigned differ_x = cell1.x ^ cell2.x;
+	unsigned differ_y = cell1.y ^ cell2.y;
+	bool y_bit_is_lower = differ_y < differ_x && differ_y < (differ_x ^ differ_y);
+	if(y_bit_is_lower) return cell1.x < cell2.x;
+	return cell1.y < cell2.y;
+}
+
+core::Vector2i ParticleGrid::CompareByGridCell::cell_of(core::Vector2f position) const {
+	// truncating instead of flooring is fine because negative cells are clamped to 0 anyway
+	int cell_x = position.x / cell_size.x;
+	int cell_y = position.y / cell_size.y;
+	return {
+		std::clamp(cell_x, 0, grid_size.x - 1),
+		std::clamp(cell_y, 0, grid_size.y - 1)
+	};
+}
+
+int ParticleGrid::CompareByGridCell::species_of(core::Color color) const {
+	auto color_int = color.toInteger();
+	for(int species = 0; species < species_count - 1; ++species) {
+		if(species_colors[species] == color_int) return species;
+	}
+	return species_count - 1;
+}
+
+std::uint64_t ParticleGrid::CompareByGridCell::subcell_of(core::Vector2f position, core::Vector2i cell) const {
+	// the same truncating and clamping as cell_of(), within the cell
+	int per_cell = 1 << levels;
+	int x = static_cast<int>(position.x * per_cell / cell_size.x) - cell.x * per_cell;
+	int y = static_cast<int>(position.y * per_cell / cell_size.y) - cell.y * per_cell;
+	x = std::clamp(x, 0, per_cell - 1);
+	y = std::clamp(y, 0, per_cell - 1);
+	return spread_bits(x) | (spread_bits(y) << 1);
+}
+
+std::uint64_t ParticleGrid::CompareByGridCell::key(const Particle& particle) const {
+	auto cell = cell_of(particle.position);
+	std::uint64_t ord = cell_ord(cell);
+	if(species_count == 1 && levels == 0) return ord;
+
+	auto key = first_key(ord, species_of(particle.color));
+	if(levels > 0) key += subcell_of(particle.position, cell);
+	return key;
+}
+
+std::uint64_t ParticleGrid::CompareByGridCell::first_key(std::uint64_t ord, int species) const {
+	return (ord * species_count + species) << (2 * levels);
+}
+
+std::uint64_t ParticleGrid::CompareByGridCell::cell_ord(core::Vector2f position) const {
+	return cell_ord(cell_of(position));
+}
+
+std::uint64_t ParticleGrid::CompareByGridCell::cell_ord(core::Vector2i cell) const {
+	if(cell_order == CellOrder::Rows) return static_cast<std::uint64_t>(grid_size.x) * cell.y + cell.x;
+
+	std::uint32_t common_mask = (1u << common_bits) - 1;
+	std::uint64_t interleaved = spread_bits(cell.x & common_mask) | (spread_bits(cell.y & common_mask) << 1);
+	std::uint64_t rest = static_cast<std::uint32_t>(bits_x > bits_y ? cell.x : cell.y) >> common_bits;
+	return interleaved | (rest << (2 * common_bits));
+}
+
+std::uint64_t ParticleGrid::CompareByGridCell::ord_count() const {
+	if(cell_order == CellOrder::Rows) return static_cast<std::uint64_t>(grid_size.x) * grid_size.y;
+	return std::uint64_t(1) << (bits_x + bits_y);
+}
 
-	return cell1_ord < cell2_ord;
+std::uint64_t ParticleGrid::CompareByGridCell::key_count() const {
+	return first_key(ord_count(), 0);
 }
@@ -1,9 +1,14 @@
 #pragma once
 
 #include <vector>
+#include <array>
+#include <memory_resource>
 #include <utility>
-#include <SFML/System.hpp>
+#include <cstdint>
+#include "CoreTypes.hpp"
 #include "Particle.hpp"
+#include "CellHashTable.hpp"
+#include "ParticleAllocator.hpp"
 
 /* Ok so it's actually a bit weird grid implementation;
  * all particles are stored in a single vector which is sorted
@@ -14,43 +19,212 @@
  * Now I'm not sure if it does, but I didn't look into it too much yet so I'm leaving it
  * just in case it will turn out useful when I do.
  * It's certainly better performing than my terrible quad tree implementation tho
+ *
+ * On huge, mostly empty boards the vector of cell positions would be mostly
+ * a waste of memory, so the grid can instead keep the ranges of the occupied cells
+ * in a hash table (CellIndex::Sparse).
+ *
+ * Cells are ordered row by row by default. With CellOrder::Morton they follow
+ * a Z-order curve instead, so the cells around a particle are mostly close together
+ * in the vector rather than a whole row apart.
+ *
+ * With set_species() the particles of every cell are also sorted by species
+ * and the cell positions are kept per species, so the particles of a single species
+ * can be found without going through all the others.
+ *
+ * With set_levels() every cell is split further into 2^levels x 2^levels subcells, and the particles
+ * of every cell and species are sorted by their subcell along a Z-order curve. Every level of subcells
+ * (halving the cells once, twice, ...) is then a run of the same vector, so a short range query
+ * can look at a few small subcells instead of whole cells, without a grid of its own to keep sorted.
+ *
+ * With keep_aggregates() sort() also works out how many particles of every species are in every cell
+ * and where their centroid is, so that far away cells can stand in for all of their particles.
  */
 
 class ParticleGrid {
+public:
+	enum class CellIndex {
+		Dense,
+		Sparse
+	};
+
+	enum class CellOrder {
+		Rows,
+		Morton
+	};
+
+	using ParticleVector = std::vector<Particle, ParticleAllocator<Particle>>;
+	using Ranges = std::pmr::vector<std::pair<std::size_t, std::size_t>>;
+
+	// the particles of one species in one cell
+	struct Aggregate {
+		core::Vector2f centroid;
+		std::uint32_t count;
+	};
+
+	static constexpr int max_species = 8;
+	static constexpr int all_species = -1;
+	// 64 subcells per cell; the cell positions grow with 4^levels
+	static constexpr int max_levels = 3;
+
+private:
 	struct CompareByGridCell {
-		int grid_width;
-		sf::Vector2f cell_size;
-		CompareByGridCell(int grid_width, sf::Vector2f cell_size);
-		bool operator()(const Particle& p1, const Particle& p2);
+		core::Vector2i grid_size;
+		core::Vector2f cell_size;
+		CellOrder cell_order;
+		// Morton: bits of the cell coordinates; the low `common_bits` of x and y are interleaved
+		// and the rest of the longer side goes on top
+		int bits_x;
+		int bits_y;
+		int common_bits;
+		// as core::Color::toInteger(); the last species (species_count - 1) is every other colour
+		std::array<std::uint32_t, max_species> species_colors;
+		int species_count;
+		// subcells along each side of a cell are 2^levels
+		int levels;
+
+		CompareByGridCell(core::Vector2i grid_size, core::Vector2f cell_size, CellOrder cell_order);
+		bool operator()(const Particle& p1, const Particle& p2) const;
+		// positions outside of the board are clamped to the nearest cell
+		core::Vector2i cell_of(core::Vector2f position) const;
+		std::uint64_t cell_ord(core::Vector2f position) const;
+		std::uint64_t cell_ord(core::Vector2i cell) const;
+		int species_of(core::Color color) const;
+		// Z-order index of the smallest subcell of `cell` that `position` is in
+		std::uint64_t subcell_of(core::Vector2f position, core::Vector2i cell) const;
+		// what the particles are sorted by: the cell, then the species, then the subcell
+		std::uint64_t key(const Particle& particle) const;
+		// key of the first particle of `species` in the cell
+		std::uint64_t first_key(std::uint64_t ord, int species) const;
+		// one past the largest cell_ord(); Morton pads the grid up to powers of two
+		std::uint64_t ord_count() const;
+		// one past the largest key()
+		std::uint64_t key_count() const;
 	};
 
-	sf::Vector2i grid_size;
-	sf::Vector2f cell_size;
+	core::Vector2i grid_size;
+	core::Vector2f cell_size;
+	CellIndex cell_index;
+	CellOrder cell_order;
 
+	// only one of them is used, depending on cell_index;
+	// both are indexed by CompareByGridCell::key()
 	std::vector<std::size_t> cell_positions;
+	CellHashTable sparse_cells;
+	// key of every particle and then the index it's moved to, kept between sorts so it doesn't allocate
+	std::vector<std::uint64_t> sort_keys;
+	// see keep_aggregates(); indexed by cell ord and species like the keys without the subcells
+	bool aggregates_kept;
+	std::vector<Aggregate> aggregates;
 
-	// one of them represents previous state
-	// while the other one is meant to be updated based on it
-	std::vector<Particle> particles1;
-	std::vector<Particle> particles2;
-	bool p1_is_new;
+	ParticleVector particles;
+	// sort() had to reallocate the particles on a single thread; see needs_spreading()
+	bool spread_needed;
+	// the new vector while spread_over_threads() fills it
+	ParticleVector placed_particles;
+
+	// index of every particle in the current vector by its id; updated whenever particles move around
+	std::vector<std::uint32_t> indices_by_id;
+
+	// changes applied all at once by the next sort()
+	std::vector<Particle> pending_appends;
+	std::vector<std::size_t> pending_removals;
 
 	CompareByGridCell compare;
 
-	std::vector<Particle>& get_mut_particles();
+	// particles with keys from `first_key` up to (not including) `end_key`
+	std::pair<std::size_t, std::size_t> get_key_range(std::uint64_t first_key, std::uint64_t end_key) const;
+	// particles of the cells with ords from `first_ord` to `last_ord`, joined to the last range if they're adjacent
+	void add_ord_range(std::uint64_t first_ord, std::uint64_t last_ord, int species, Ranges& ranges) const;
+	// the part of the aligned square of 2^level cells at `origin` that's between `first_cell` and `last_cell`
+	void add_morton_ranges(
+			core::Vector2i first_cell,
+			core::Vector2i last_cell,
+			core::Vector2i origin,
+			int level,
+			int species,
+			Ranges& ranges) const;
+	// the subcells of `level` overlapping `area`, one range per subcell and species
+	void add_level_ranges(core::FloatRect area, int species, int level, Ranges& ranges) const;
+	// dense grids are sorted by counting: every key once, then every particle moved straight to its place
+	void counting_sort();
+	void rebuild_sparse_cells();
+	void rebuild_indices_by_id();
+	void set_index_of(std::uint32_t id, std::size_t index);
+	void apply_pending_changes();
 
 public:
+	// in indices_by_id for ids that aren't used
+	static constexpr std::uint32_t no_index = UINT32_MAX;
+
+	ParticleGrid(core::Vector2i window_size, int cell_resolution);
+	ParticleGrid(core::Vector2i board_size, float cell_size, CellIndex cell_index, CellOrder cell_order = CellOrder::Rows);
 
-	ParticleGrid(sf::Vector2i window_size, int cell_resolution);
+	// how many cell positions a dense grid like that would clear and count up on every sort():
+	// one per cell (Morton pads the grid to powers of two), species and subcell
+	static std::uint64_t dense_key_count(
+			core::Vector2i board_size,
+			float cell_size,
+			CellOrder cell_order,
+			int species_count,
+			int levels);
 
-	const std::vector<Particle>& get_particles() const;
-	const std::vector<Particle>& get_new_particles() const;
-	std::vector<Particle>& get_mut_new_particles();
-	std::vector<std::pair<std::size_t, std::size_t>> get_ranges_in(sf::FloatRect area) const;
+	const ParticleVector& get_particles() const;
+	// particles can be moved in place; the grid is then out of date until the next sort()
+	ParticleVector& get_mut_particles();
+	// ranges of particle indices covering the cells overlapping `area`, in the order of the vector;
+	// one per grid row with CellOrder::Rows, one per run of the curve with CellOrder::Morton.
+	// All particles inside `area` are in them, but so can be some outside.
+	// With `species` only the particles of that species (see set_species()), one range per cell.
+	// With `level` (see set_levels()) the subcells of that level instead of whole cells, one range per subcell,
+	// not necessarily in the order of the vector; levels past get_levels() are the same as the finest one.
+	// The ranges live in the calling thread's FrameArena, so they're gone after the next step
+	Ranges get_ranges_in(core::FloatRect area, int species = all_species, int level = 0) const;
+	// the same into `ranges`, which is cleared first; loops asking over and over should keep one
+	// and pass it every time, so that it only grows a few times instead of once per query
+	void get_ranges_in(core::FloatRect area, Ranges& ranges, int species = all_species, int level = 0) const;
+	// positions outside of the board are clamped to the nearest cell
+	core::Vector2i get_cell_of(core::Vector2f position) const;
+	// particles of a single cell, or with `species` only the ones of that species; `cell` must be within the grid
+	std::pair<std::size_t, std::size_t> get_cell_range(core::Vector2i cell, int species = all_species) const;
+	// maps particle ids to their indices in get_particles(); ids that aren't used map to no_index
+	const std::vector<std::uint32_t>& get_indices_by_id() const;
+	CellIndex get_cell_index() const;
+	CellOrder get_cell_order() const;
+	core::Vector2i get_grid_size() const;
+	core::Vector2f get_cell_size() const;
+	// sorts the particles of every cell by species: the index of their colour in `colors`
+	// (at most max_species of them), or colors.size() for any other colour
+	void set_species(const std::vector<core::Color>& colors);
+	// colours given to set_species() plus one for the rest
+	int get_species_count() const;
+	// the colour given to set_species() for `species`; the last species is every other colour and has none
+	core::Color get_species_color(int species) const;
+	// splits every cell into 2^levels x 2^levels subcells (up to max_levels); only dense grids can have levels,
+	// the sparse index would have to look up every subcell of a cell on its own
+	void set_levels(int levels);
+	int get_levels() const;
+	// makes sort() work out the count and the centroid of the particles of every species in every cell;
+	// only dense grids keep them, like levels
+	void keep_aggregates(bool keep);
+	// as of the last sort(); `cell` must be within the grid and `species` a single one
+	const Aggregate& get_aggregate(core::Vector2i cell, int species) const;
 
 	void insert(const Particle& particle);
+	// cheaper than insert() but leaves the grid unsorted; call sort() after appending
+	void append(const Particle& particle);
 	void remove(const Particle& particle);
+	// cheap ways to add and remove many particles; they take effect when sort() is called
+	void queue_append(const Particle& particle);
+	void queue_remove(std::size_t index);
+	// on dense grids the particles are counted into their places and moved there in place
 	void sort();
-	void swap_vecs();
-	void init_new_with_old();
+	// the vector is reallocated and filled in parallel, split between the threads
+	// like the force loop does (schedule(static)), so on NUMA machines every thread
+	// finds its part of the particles in its local memory
+	void spread_over_threads();
+	// the same inside a parallel region; every thread of the team has to call it
+	void spread_over_team();
+	// true when sort() added particles and that moved the vector; spreading it again puts it right
+	bool needs_spreading() const;
 };
@@ -0,0 +1,72 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <cstddef>
+
+/* Layout of the shared memory written by Publisher (`--publish`).
+ * Unlike recordings it's only read on the same machine, so everything is in native
+ * byte order and readers can use the particles right where they are.
+ *
+ * Header, then `slot_count` slots. Each slot is a SlotHeader followed by room for
+ * `slot_capacity` particles. Frames go to the slots in turn; `latest_frame` is the number
+ * of the newest complete frame plus one (0 before the first one), in slot `(latest_frame - 1) % slot_count`.
+ *
+ * Every slot is guarded by a seqlock: `sequence` is odd while the slot is being written.
+ * Readers read `sequence`, read the frame, then read `sequence` again; if it changed
+ * (or was odd) the frame got overwritten in the meantime and has to be read again.
+ * The writer never waits for readers.
+ */
+
+namespace publishing {
+	const std::uint32_t magic = 0x534c4631; // "SLF1"
+
+	struct Particle {
+		float x;
+		float y;
+		float velocity_x;
+		float velocity_y;
+		std::uint8_t r;
+		std::uint8_t g;
+		std::uint8_t b;
+		std::uint8_t a;
+		std::uint32_t id;
+	};
+
+	// separate cache lines so readers polling one slot don't slow down writing another
+	struct alignas(64) SlotHeader {
+		std::atomic<std::uint64_t> sequence;
+		std::uint64_t frame;
+		// particles that didn't fit in the slot are left out
+		std::uint32_t particle_count;
+	};
+
+	struct alignas(64) Header {
+		std::uint32_t magic;
+		std::uint32_t slot_count;
+		std::uint32_t slot_capacity;
+		std::int32_t board_width;
+		std::int32_t board_height;
+		std::atomic<std::uint64_t> latest_frame;
+	};
+
+	static_assert(std::atomic<std::uint64_t>::is_always_lock_free, "shared memory needs lock free atomics");
+
+	inline std::size_t slot_size(std::uint32_t slot_capacity) {
+		std::size_t size = sizeof(SlotHeader) + slot_capacity * sizeof(Particle);
+		return (size + 63) / 64 * 64;
+	}
+
+	inline std::size_t memory_size(std::uint32_t slot_count, std::uint32_t slot_capacity) {
+		return sizeof(Header) + slot_count * slot_size(slot_capacity);
+	}
+
+	inline SlotHeader* slot_at(Header* header, std::uint32_t slot) {
+		auto* base = reinterpret_cast<char*>(header) + sizeof(Header);
+		return reinterpret_cast<SlotHeader*>(base + slot * slot_size(header->slot_capacity));
+	}
+
+	inline Particle* particles_of(SlotHeader* slot) {
+		return reinterpret_cast<Particle*>(reinterpret_cast<char*>(slot) + sizeof(SlotHeader));
+	}
+}
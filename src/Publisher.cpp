@@ -0,0 +1,102 @@
+#include "Publisher.hpp"
+#include <algorithm>
+
+#if __has_include(<sys/mman.h>)
+	#define SHM_PRESENT
+	#include <sys/mman.h>
+	#include <sys/stat.h>
+	#include <fcntl.h>
+	#include <unistd.h>
+#endif
+
+Publisher::Publisher(std::string_view name, core::Vector2i board_size, std::uint32_t capacity):
+	name(name),
+	header(nullptr),
+	size(publishing::memory_size(slot_count, capacity)),
+	next_frame(0)
+{
+	if(this->name.empty() || this->name[0] != '/') this->name = "/" + this->name;
+
+	#ifdef SHM_PRESENT
+		int fd = shm_open(this->name.c_str(), O_CREAT | O_RDWR, 0644);
+		if(fd < 0) {
+			errors += "Can't create shared memory: " + this->name + "\n";
+			return;
+		}
+
+		void* memory = MAP_FAILED;
+		if(ftruncate(fd, size) == 0) memory = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+		close(fd);
+
+		if(memory == MAP_FAILED) {
+			errors += "Can't map shared memory: " + this->name + "\n";
+			shm_unlink(this->name.c_str());
+			return;
+		}
+
+		// the magic goes in last so readers don't start on a half set up header
+		header = static_cast<publishing::Header*>(memory);
+		header->slot_count = slot_count;
+		header->slot_capacity = capacity;
+		header->board_width = board_size.x;
+		header->board_height = board_size.y;
+		header->latest_frame.store(0, std::memory_order_relaxed);
+
+		for(std::uint32_t i=0; i<slot_count; ++i) {
+			auto* slot = publishing::slot_at(header, i);
+			slot->sequence.store(0, std::memory_order_relaxed);
+			slot->frame = 0;
+			slot->particle_count = 0;
+		}
+
+		std::atomic_thread_fence(std::memory_order_release);
+		header->magic = publishing::magic;
+	#else
+		(void)board_size;
+		errors += "Publishing needs POSIX shared memory, which isn't available on this system\n";
+	#endif
+}
+
+Publisher::~Publisher() {
+	#ifdef SHM_PRESENT
+		if(header == nullptr) return;
+		munmap(header, size);
+		shm_unlink(name.c_str());
+	#endif
+}
+
+const std::string& Publisher::get_errors() const {
+	return errors;
+}
+
+const std::string& Publisher::get_name() const {
+	return name;
+}
+
+void Publisher::publish(const ParticleGrid::ParticleVector& particles) {
+	if(header == nullptr) return;
+
+	auto* slot = publishing::slot_at(header, next_frame % slot_count);
+	auto* out = publishing::particles_of(slot);
+	auto count = static_cast<std::uint32_t>(std::min<std::size_t>(particles.size(), header->slot_capacity));
+
+	auto sequence = slot->sequence.load(std::memory_order_relaxed);
+	slot->sequence.store(sequence + 1, std::memory_order_relaxed);
+	std::atomic_thread_fence(std::memory_order_release);
+
+	for(std::uint32_t i=0; i<count; ++i) {
+		const auto& particle = particles[i];
+		out[i] = publishing::Particle {
+			particle.position.x, particle.position.y,
+			particle.velocity.x, particle.velocity.y,
+			particle.color.r, particle.color.g, particle.color.b, particle.color.a,
+			particle.id
+		};
+	}
+	slot->frame = next_frame;
+	slot->particle_count = count;
+
+	slot->sequence.store(sequence + 2, std::memory_order_release);
+	header->latest_frame.store(next_frame + 1, std::memory_order_release);
+	++next_frame;
+}
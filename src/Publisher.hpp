@@ -0,0 +1,37 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include "CoreTypes.hpp"
+#include "ParticleGrid.hpp"
+#include "PublishLayout.hpp"
+
+/* Writes frames into POSIX shared memory for other processes to read while
+ * the simulation runs; see PublishLayout.hpp for the layout.
+ * The shared memory object is removed when the Publisher is destroyed.
+ */
+
+class Publisher {
+	static const std::uint32_t slot_count = 4;
+
+	std::string name;
+	publishing::Header* header;
+	std::size_t size;
+	std::uint64_t next_frame;
+	std::string errors;
+
+public:
+	// `name` is the name of the shared memory object (a `/` is put in front if missing);
+	// frames with more than `capacity` particles are cut short
+	Publisher(std::string_view name, core::Vector2i board_size, std::uint32_t capacity);
+	~Publisher();
+
+	Publisher(const Publisher&) = delete;
+	Publisher& operator=(const Publisher&) = delete;
+
+	const std::string& get_errors() const;
+	const std::string& get_name() const;
+
+	void publish(const ParticleGrid::ParticleVector& particles);
+};
@@ -0,0 +1,53 @@
+#include "Rasterizer.hpp"
+#include <cmath>
+#include <algorithm>
+
+Rasterizer::Rasterizer(core::Vector2i world_size, sf::Vector2u max_image_size) {
+	scale = std::min({1.f,
+			static_cast<float>(max_image_size.x) / world_size.x,
+			static_cast<float>(max_image_size.y) / world_size.y});
+
+	// video encoders usually want even dimensions
+	image_size.x = std::max(2u, static_cast<unsigned>(world_size.x * scale) / 2 * 2);
+	image_size.y = std::max(2u, static_cast<unsigned>(world_size.y * scale) / 2 * 2);
+}
+
+sf::Vector2u Rasterizer::get_image_size() const {
+	return image_size;
+}
+
+void Rasterizer::draw_point(core::Vector2f pos, core::Color color, std::vector<sf::Uint8>& pixels) const {
+	// same hexagon as sf::CircleShape(POINT_RADIUS, 6): a vertex at the top and bottom,
+	// so the sides are vertical and every edge is `apothem` away from the center
+	const float radius = POINT_RADIUS * scale;
+	const float apothem = radius * std::sqrt(3.f) / 2;
+	const float slant = std::sqrt(3.f) / 2;
+
+	auto center = pos * scale;
+	int min_x = std::max(0, static_cast<int>(std::floor(center.x - apothem)));
+	int max_x = std::min(static_cast<int>(image_size.x) - 1, static_cast<int>(std::ceil(center.x + apothem)));
+	int min_y = std::max(0, static_cast<int>(std::floor(center.y - radius)));
+	int max_y = std::min(static_cast<int>(image_size.y) - 1, static_cast<int>(std::ceil(center.y + radius)));
+
+	for(int y = min_y; y <= max_y; ++y) {
+		float dy = std::abs(y + 0.5f - center.y);
+
+		for(int x = min_x; x <= max_x; ++x) {
+			float dx = std::abs(x + 0.5f - center.x);
+			if(dx > apothem || dx * 0.5f + dy * slant > apothem) continue;
+
+			auto* pixel = &pixels[(static_cast<std::size_t>(y) * image_size.x + x) * 4];
+			pixel[0] = color.r;
+			pixel[1] = color.g;
+			pixel[2] = color.b;
+			pixel[3] = 255;
+		}
+	}
+}
+
+void Rasterizer::draw(const std::vector<Particle>& particles, std::vector<sf::Uint8>& pixels) const {
+	pixels.assign(static_cast<std::size_t>(image_size.x) * image_size.y * 4, 0);
+	for(std::size_t i = 3; i < pixels.size(); i += 4) pixels[i] = 255;
+
+	for(const auto& particle : particles) draw_point(particle.position, particle.color, pixels);
+}
@@ -0,0 +1,26 @@
+#pragma once
+
+#include <vector>
+#include <SFML/System.hpp>
+#include "Particle.hpp"
+
+/* Draws particles into an RGBA buffer on the CPU, without a window or a GPU.
+ * Particles look the same as in Display: hexagons of POINT_RADIUS, a pixel is
+ * filled when its center is inside one, later particles are drawn over earlier ones.
+ */
+
+class Rasterizer {
+	sf::Vector2u image_size;
+	// image pixels per world unit
+	float scale;
+
+	void draw_point(core::Vector2f pos, core::Color color, std::vector<sf::Uint8>& pixels) const;
+
+public:
+	// the whole world is drawn, scaled down to fit in max_image_size if it's larger
+	Rasterizer(core::Vector2i world_size, sf::Vector2u max_image_size);
+
+	sf::Vector2u get_image_size() const;
+	// resizes `pixels` to the image size, clears it to black and draws the particles
+	void draw(const std::vector<Particle>& particles, std::vector<sf::Uint8>& pixels) const;
+};
@@ -24,15 +24,15 @@ std::vector<std::string> Recipe::line_to_words(const std::string& line) {
 	return words;
 }
 
-std::optional<sf::Color> Recipe::string_to_color(const std::string& str) {
-	if(str == "black") return sf::Color::Black;
-	if(str == "white") return sf::Color::White;
-	if(str == "red") return sf::Color::Red;
-	if(str == "green") return sf::Color::Green;
-	if(str == "blue") return sf::Color::Blue;
-	if(str == "yellow") return sf::Color::Yellow;
-	if(str == "magenta") return sf::Color::Magenta;
-	if(str == "cyan") return sf::Color::Cyan;
+std::optional<core::Color> Recipe::string_to_color(const std::string& str) {
+	if(str == "black") return core::Color::Black;
+	if(str == "white") return core::Color::White;
+	if(str == "red") return core::Color::Red;
+	if(str == "green") return core::Color::Green;
+	if(str == "blue") return core::Color::Blue;
+	if(str == "yellow") return core::Color::Yellow;
+	if(str == "magenta") return core::Color::Magenta;
+	if(str == "cyan") return core::Color::Cyan;
 	return std::nullopt;
 }
 
@@ -64,7 +64,7 @@ std::optional<Recipe::Step> Recipe::load_particles(const std::vector<std::string
 		errors += std::string("\"") + words[1] + "\" is not a valid color\n";
 		return std::nullopt;
 	}
-	sf::Color color = maybe_color.value();
+	core::Color color = maybe_color.value();
 
 	auto maybe_amount = strutil::stoi(words[2]);
 	if(!maybe_amount.has_value()) {
@@ -87,14 +87,14 @@ std::optional<Recipe::Step> Recipe::load_rule(const std::vector<std::string>& wo
 		errors += std::string("\"") + words[1] + "\" is not a valid color\n";
 		return std::nullopt;
 	}
-	sf::Color color1 = maybe_color.value();
+	core::Color color1 = maybe_color.value();
 
 	maybe_color = string_to_color(words[2]);
 	if(!maybe_color.has_value()) {
 		errors += std::string("\"") + words[2] + "\" is not a valid color\n";
 		return std::nullopt;
 	}
-	sf::Color color2 = maybe_color.value();
+	core::Color color2 = maybe_color.value();
 
 	auto maybe_value = strutil::stof(words[3]);
 	if(!maybe_value.has_value()) {
@@ -120,6 +120,51 @@ std::optional<Recipe::Step> Recipe::load_rule(const std::vector<std::string>& wo
 	return Rule { color1, color2, first_cut, second_cut, peak };
 }
 
+// emitters and sinks are written the same way
+std::optional<Recipe::Emitter> Recipe::load_flow(const std::vector<std::string>& words) {
+	if(words.size() != 7) {
+		errors += "Invalid number of arguments for `" + words[0] + "` (6 expected)\n";
+		return std::nullopt;
+	}
+
+	auto maybe_color = string_to_color(words[1]);
+	if(!maybe_color.has_value()) {
+		errors += std::string("\"") + words[1] + "\" is not a valid color\n";
+		return std::nullopt;
+	}
+	core::Color color = maybe_color.value();
+
+	float values[5];
+	for(int i=0; i<5; ++i) {
+		auto maybe_value = strutil::stof(words[i + 2]);
+		if(!maybe_value.has_value()) {
+			errors += std::string("\"") + words[i + 2] + "\" is not a floating point number\n";
+			return std::nullopt;
+		}
+		values[i] = maybe_value.value();
+	}
+
+	if(values[2] <= 0 || values[3] <= 0 || values[4] < 0) {
+		errors += "Size of the area of `" + words[0] + "` must be positive and its rate can't be negative\n";
+		return std::nullopt;
+	}
+
+	return Emitter { color, core::FloatRect(values[0], values[1], values[2], values[3]), values[4] };
+}
+
+std::optional<Recipe::Step> Recipe::load_emitter(const std::vector<std::string>& words) {
+	auto maybe_flow = load_flow(words);
+	if(!maybe_flow.has_value()) return std::nullopt;
+	return maybe_flow.value();
+}
+
+std::optional<Recipe::Step> Recipe::load_sink(const std::vector<std::string>& words) {
+	auto maybe_flow = load_flow(words);
+	if(!maybe_flow.has_value()) return std::nullopt;
+	auto flow = maybe_flow.value();
+	return Sink { flow.color, flow.area, flow.rate };
+}
+
 std::optional<Recipe::Step> Recipe::load_window(const std::vector<std::string>& words) {
 	if(words.size() != 3) {
 		errors += "Invalid number of arguments for `window` (2 expected)\n";
@@ -143,6 +188,29 @@ std::optional<Recipe::Step> Recipe::load_window(const std::vector<std::string>&
 	return Window { width, height };
 }
 
+std::optional<Recipe::Step> Recipe::load_world(const std::vector<std::string>& words) {
+	if(words.size() != 3) {
+		errors += "Invalid number of arguments for `world` (2 expected)\n";
+		return std::nullopt;
+	}
+
+	auto maybe_value = strutil::stoi_positive(words[1]);
+	if(!maybe_value.has_value()) {
+		errors += std::string("\"") + words[1] + "\" is not a positive integer number\n";
+		return std::nullopt;
+	}
+	int width = maybe_value.value();
+
+	maybe_value = strutil::stoi_positive(words[2]);
+	if(!maybe_value.has_value()) {
+		errors += std::string("\"") + words[2] + "\" is not a positive integer number\n";
+		return std::nullopt;
+	}
+	int height = maybe_value.value();
+
+	return World { width, height };
+}
+
 const std::string& Recipe::load(std::string_view filename) {
 	errors = "";
 	steps.clear();
@@ -154,6 +222,7 @@ const std::string& Recipe::load(std::string_view filename) {
 	}
 
 	bool first = true;
+	bool second = false;
 
 	std::string line_buffer;
 	while(std::getline(file, line_buffer)) {
@@ -168,14 +237,21 @@ const std::string& Recipe::load(std::string_view filename) {
 		} else if(!first && words[0] == "window") {
 			errors += "Recipe must only have one `window` command\n";
 			break;
+		} else if(!second && words[0] == "world") {
+			errors += "The `world` command must directly follow the `window` command\n";
+			break;
 		}
 
+		second = first;
 		first = false;
 		std::optional<Step> maybe_step = std::nullopt;
 		if(words[0] == "window") maybe_step = load_window(words);
+		else if(words[0] == "world") maybe_step = load_world(words);
 		else if(words[0] == "friction") maybe_step = load_friction(words);
 		else if(words[0] == "particles") maybe_step = load_particles(words);
 		else if(words[0] == "rule") maybe_step = load_rule(words);
+		else if(words[0] == "emitter") maybe_step = load_emitter(words);
+		else if(words[0] == "sink") maybe_step = load_sink(words);
 		else {
 			errors += std::string("Unknown command \"") + words[0] + "\"";
 			continue;
@@ -195,3 +271,7 @@ const std::string& Recipe::get_errors() const {
 const std::vector<Recipe::Step>& Recipe::get_steps() const {
 	return steps;
 }
+
+void Recipe::add_step(const Step& step) {
+	steps.push_back(step);
+}
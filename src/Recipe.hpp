@@ -4,33 +4,43 @@
 #include <variant>
 #include <optional>
 #include <string>
-#include <SFML/Graphics.hpp>
+#include "CoreTypes.hpp"
 #include "Rule.hpp"
 
 class Recipe {
 public:
 	struct Window { int width; int height; };
+	struct World { int width; int height; };
 	struct Friction { float value; };
-	struct Particles { sf::Color color; int amount; };
+	struct Particles { core::Color color; int amount; };
+	// `rate` particles per simulation step are spawned in (or removed from) `area`
+	struct Emitter { core::Color color; core::FloatRect area; float rate; };
+	struct Sink { core::Color color; core::FloatRect area; float rate; };
 
-	using Step = std::variant<Window, Friction, Particles, Rule>;
+	using Step = std::variant<Window, World, Friction, Particles, Rule, Emitter, Sink>;
 
 private:
 	std::vector<Step> steps;
 	std::string errors;
 
-	std::vector<std::string> line_to_words(const std::string& line);
-	std::optional<sf::Color> string_to_color(const std::string& str);
-
 	std::optional<Step> load_window(const std::vector<std::string>& words);
+	std::optional<Step> load_world(const std::vector<std::string>& words);
 	std::optional<Step> load_friction(const std::vector<std::string>& words);
 	std::optional<Step> load_particles(const std::vector<std::string>& words);
 	std::optional<Step> load_rule(const std::vector<std::string>& words);
+	std::optional<Emitter> load_flow(const std::vector<std::string>& words);
+	std::optional<Step> load_emitter(const std::vector<std::string>& words);
+	std::optional<Step> load_sink(const std::vector<std::string>& words);
 
 public:
+	static std::vector<std::string> line_to_words(const std::string& line);
+	static std::optional<core::Color> string_to_color(const std::string& str);
+
+	Recipe() = default;
 	Recipe(std::string_view filename);
 
 	const std::string& load(std::string_view filename);
 	const std::string& get_errors() const;
 	const std::vector<Step>& get_steps() const;
+	void add_step(const Step& step);
 };
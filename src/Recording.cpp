@@ -0,0 +1,76 @@
+#include "Recording.hpp"
+#include <cstring>
+#include <algorithm>
+
+namespace recording {
+	namespace {
+		template<typename T>
+		void append_value(std::vector<char>& buffer, T value, bool cpu_is_big_endian) {
+			char bytes[sizeof(T)];
+			std::memcpy(bytes, &value, sizeof(T));
+			if(cpu_is_big_endian) std::reverse(bytes, bytes + sizeof(T));
+			buffer.insert(buffer.end(), bytes, bytes + sizeof(T));
+		}
+
+		template<typename T>
+		T read_value(const char* data, bool cpu_is_big_endian) {
+			char bytes[sizeof(T)];
+			std::memcpy(bytes, data, sizeof(T));
+			if(cpu_is_big_endian) std::reverse(bytes, bytes + sizeof(T));
+
+			T value;
+			std::memcpy(&value, bytes, sizeof(T));
+			return value;
+		}
+	}
+
+	void write_header(std::ostream& out, core::Vector2i board_size, std::int32_t particle_count, bool cpu_is_big_endian) {
+		std::vector<char> buffer;
+		append_value<std::int32_t>(buffer, board_size.x, cpu_is_big_endian);
+		append_value<std::int32_t>(buffer, board_size.y, cpu_is_big_endian);
+		append_value<std::int32_t>(buffer, particle_count, cpu_is_big_endian);
+		out.write(buffer.data(), buffer.size());
+	}
+
+	bool read_header(std::istream& in, core::Vector2i& board_size, std::int32_t& particle_count, bool cpu_is_big_endian) {
+		char data[3 * sizeof(std::int32_t)];
+		if(!in.read(data, sizeof(data))) return false;
+
+		board_size.x = read_value<std::int32_t>(data, cpu_is_big_endian);
+		board_size.y = read_value<std::int32_t>(data + sizeof(std::int32_t), cpu_is_big_endian);
+		particle_count = read_value<std::int32_t>(data + 2 * sizeof(std::int32_t), cpu_is_big_endian);
+		return particle_count >= 0 || particle_count == variable_particle_count;
+	}
+
+	void append_particle_count(std::vector<char>& buffer, std::int32_t particle_count, bool cpu_is_big_endian) {
+		append_value(buffer, particle_count, cpu_is_big_endian);
+	}
+
+	bool read_particle_count(std::istream& in, std::int32_t& particle_count, bool cpu_is_big_endian) {
+		char data[sizeof(std::int32_t)];
+		if(!in.read(data, sizeof(data))) return false;
+		particle_count = read_value<std::int32_t>(data, cpu_is_big_endian);
+		return particle_count >= 0;
+	}
+
+	void append_particle(std::vector<char>& buffer, const Particle& particle, bool cpu_is_big_endian) {
+		append_value(buffer, particle.position.x, cpu_is_big_endian);
+		append_value(buffer, particle.position.y, cpu_is_big_endian);
+		append_value(buffer, particle.velocity.x, cpu_is_big_endian);
+		append_value(buffer, particle.velocity.y, cpu_is_big_endian);
+		buffer.push_back(particle.color.r);
+		buffer.push_back(particle.color.g);
+		buffer.push_back(particle.color.b);
+		buffer.push_back(particle.color.a);
+	}
+
+	void read_particle(const char* data, Particle& particle, bool cpu_is_big_endian) {
+		particle.position.x = read_value<float>(data, cpu_is_big_endian);
+		particle.position.y = read_value<float>(data + sizeof(float), cpu_is_big_endian);
+		particle.velocity.x = read_value<float>(data + 2 * sizeof(float), cpu_is_big_endian);
+		particle.velocity.y = read_value<float>(data + 3 * sizeof(float), cpu_is_big_endian);
+
+		const char* color = data + 4 * sizeof(float);
+		particle.color = core::Color(color[0], color[1], color[2], color[3]);
+	}
+}
@@ -0,0 +1,32 @@
+#pragma once
+
+#include <vector>
+#include <istream>
+#include <ostream>
+#include <cstdint>
+#include "CoreTypes.hpp"
+#include "Particle.hpp"
+
+/* Layout of recording files, shared by Simulation and Replayer.
+ * Header: board width, board height, particle count (32 bit integers).
+ * Then frames of `particle count` particles, each being
+ * position x, position y, velocity x, velocity y (floats), and color (r, g, b, a bytes).
+ * Everything is little endian. Particle ids aren't recorded.
+ * If the number of particles changes during the simulation, the particle count in the header
+ * is `variable_particle_count` and every frame starts with its own particle count.
+ */
+
+namespace recording {
+	const std::size_t particle_size = 4 * sizeof(float) + 4;
+	const std::int32_t variable_particle_count = -1;
+
+	void write_header(std::ostream& out, core::Vector2i board_size, std::int32_t particle_count, bool cpu_is_big_endian);
+	bool read_header(std::istream& in, core::Vector2i& board_size, std::int32_t& particle_count, bool cpu_is_big_endian);
+
+	void append_particle_count(std::vector<char>& buffer, std::int32_t particle_count, bool cpu_is_big_endian);
+	bool read_particle_count(std::istream& in, std::int32_t& particle_count, bool cpu_is_big_endian);
+
+	void append_particle(std::vector<char>& buffer, const Particle& particle, bool cpu_is_big_endian);
+	// `data` must point at `particle_size` bytes
+	void read_particle(const char* data, Particle& particle, bool cpu_is_big_endian);
+}
@@ -1,19 +1,32 @@
 #include "Replayer.hpp"
 #include <array>
+#include "Recording.hpp"
 
 Replayer::Replayer(std::string_view recording_file, bool cpu_is_big_endian):
-	cpu_is_big_endian(cpu_is_big_endian)
+	cpu_is_big_endian(cpu_is_big_endian),
+	variable_population(false)
 {
 	file_input.open(recording_file.data(), std::ios::binary);
 	if(!file_input.good()) return;
 
-	std::size_t particle_count;
+	std::int32_t particle_count;
+	if(!recording::read_header(file_input, board_size, particle_count, cpu_is_big_endian)) {
+		file_input.setstate(std::ios::failbit);
+		return;
+	}
+
+	// otherwise every frame says how many particles it has
+	variable_population = particle_count == recording::variable_particle_count;
+	if(!variable_population) resize_frame(particle_count);
+}
 
-	file_input.read(reinterpret_cast<char*>(&board_size.x), sizeof(int));
-	file_input.read(reinterpret_cast<char*>(&board_size.y), sizeof(int));
-	file_input.read(reinterpret_cast<char*>(&particle_count), sizeof(std::size_t));
+void Replayer::resize_frame(std::size_t particle_count) {
+	if(particles.size() > particle_count) particles.erase(particles.begin() + particle_count, particles.end());
+	for(std::size_t i = particles.size(); i < particle_count; ++i) {
+		particles.push_back(Particle({0, 0}, {0, 0}, core::Color::Black, i));
+	}
 
-	particles.resize(particle_count, Particle({0, 0}, {0, 0}, sf::Color::Black));
+	frame_buffer.resize(particle_count * recording::particle_size);
 }
 
 bool Replayer::is_good() const {
@@ -24,22 +37,24 @@ const std::vector<Particle>& Replayer::get_particles() const {
 	return particles;
 }
 
-const sf::Vector2i& Replayer::get_board_size() const {
+const core::Vector2i& Replayer::get_board_size() const {
 	return board_size;
 }
 
-void Replayer::next_frame() {
-	if(!file_input.good() || file_input.eof()) return;
+bool Replayer::next_frame() {
+	if(!file_input.good() || file_input.eof()) return false;
+
+	if(variable_population) {
+		std::int32_t particle_count;
+		if(!recording::read_particle_count(file_input, particle_count, cpu_is_big_endian)) return false;
+		resize_frame(particle_count);
+	}
+
+	if(!file_input.read(frame_buffer.data(), frame_buffer.size())) return false;
 
 	for(std::size_t i=0; i<particles.size(); ++i) {
-		// the file should be little endian (reading in reverse not tested)
-		if(cpu_is_big_endian) {
-			auto* ptr = reinterpret_cast<char*>(&particles[i]);
-			for(int i = sizeof(Particle) - 1; i >= 0; --i) {
-				file_input.read(ptr + i, 1);
-			}
-		} else {
-			file_input.read(reinterpret_cast<char*>(&particles[i]), sizeof(Particle));
-		}
+		recording::read_particle(&frame_buffer[i * recording::particle_size], particles[i], cpu_is_big_endian);
 	}
+
+	return true;
 }
@@ -9,7 +9,11 @@ class Replayer {
 	bool cpu_is_big_endian;
 	std::ifstream file_input;
 	std::vector<Particle> particles;
-	sf::Vector2i board_size;
+	std::vector<char> frame_buffer;
+	core::Vector2i board_size;
+	bool variable_population;
+
+	void resize_frame(std::size_t particle_count);
 
 public:
 
@@ -17,7 +21,8 @@ public:
 
 	bool is_good() const;
 	const std::vector<Particle>& get_particles() const;
-	const sf::Vector2i& get_board_size() const;
+	const core::Vector2i& get_board_size() const;
 
-	void next_frame();
+	// false once there are no more frames; the particles stay as they were
+	bool next_frame();
 };
@@ -1,10 +1,10 @@
 #pragma once
 
-#include <SFML/Graphics.hpp>
+#include "CoreTypes.hpp"
 
 struct Rule {
-	sf::Color particle1_color;
-	sf::Color particle2_color;
+	core::Color particle1_color;
+	core::Color particle2_color;
 	float first_cut;
 	float second_cut;
 	float peak;
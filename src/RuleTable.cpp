@@ -0,0 +1,96 @@
+#include "RuleTable.hpp"
+#include <set>
+#include <type_traits>
+
+namespace rule_table {
+	namespace {
+		template<int Species>
+		AnyTable fill(const std::vector<core::Color>& colors, const std::vector<Rule>& rules) {
+			Table<Species> table {};
+			std::copy(colors.begin(), colors.end(), table.colors.begin());
+			// pairs without a rule get a kernel that's never in reach
+			table.kernels.fill(make_kernel(Rule { core::Color::Black, core::Color::Black, 0, 0, 0 }));
+
+			for(const auto& rule : rules) {
+				int species1 = table.species_of(rule.particle1_color);
+				int species2 = table.species_of(rule.particle2_color);
+				table.kernels[species1 * Species + species2] = make_kernel(rule);
+			}
+
+			return table;
+		}
+
+		template<int... Counts>
+		AnyTable fill_any(const std::vector<core::Color>& colors, const std::vector<Rule>& rules, std::integer_sequence<int, Counts...>) {
+			AnyTable table;
+			((colors.size() == Counts ? (table = fill<Counts>(colors, rules), 0) : 0), ...);
+			return table;
+		}
+	}
+
+	bool does_something(const Rule& rule) {
+		// nothing is further away than a negative second_cut
+		if(rule.second_cut <= 0) return false;
+		// closer than first_cut particles are always pushed apart
+		if(rule.first_cut > 0) return true;
+		// past it the force falls off from the peak
+		return rule.peak != 0 && rule.second_cut != rule.first_cut;
+	}
+
+	Kernel make_kernel(const Rule& rule) {
+		Kernel kernel { rule.first_cut, 0, -1, rule.peak, 0, 0, 0 };
+		if(!does_something(rule)) return kernel;
+
+		kernel.reach = rule.second_cut;
+		kernel.second_cut_squared = rule.second_cut * rule.second_cut;
+		if(rule.second_cut != rule.first_cut) {
+			kernel.outer_peak = rule.peak;
+			kernel.slope = rule.peak / (rule.second_cut - rule.first_cut);
+		}
+		return kernel;
+	}
+
+	AnyTable make(const std::vector<Rule>& rules) {
+		std::vector<core::Color> colors;
+		std::set<std::pair<std::uint32_t, std::uint32_t>> pairs;
+
+		for(const auto& rule : rules) {
+			// forces of rules for the same pair add up, which a table can't hold
+			auto pair = std::make_pair(rule.particle1_color.toInteger(), rule.particle2_color.toInteger());
+			if(!pairs.insert(pair).second) return std::monostate();
+
+			for(auto color : { rule.particle1_color, rule.particle2_color }) {
+				if(std::find(colors.begin(), colors.end(), color) == colors.end()) colors.push_back(color);
+			}
+		}
+
+		return fill_any(colors, rules, std::integer_sequence<int, 1, 2, 3, 4, 5, 6, 7, 8>());
+	}
+
+	std::vector<core::Color> colors_of(const AnyTable& table) {
+		std::vector<core::Color> colors;
+		std::visit([&colors](const auto& table) {
+			if constexpr(!std::is_same_v<std::decay_t<decltype(table)>, std::monostate>) {
+				colors.assign(table.colors.begin(), table.colors.end());
+			}
+		}, table);
+		return colors;
+	}
+
+	int set_levels(AnyTable& table, float cell_size, float min_cell_size, int max_levels) {
+		int highest = 0;
+		std::visit([&](auto& table) {
+			if constexpr(!std::is_same_v<std::decay_t<decltype(table)>, std::monostate>) {
+				for(auto& kernel : table.kernels) {
+					kernel.level = 0;
+					if(kernel.reach <= 0) continue;
+
+					float smallest = std::max(kernel.reach * 2, min_cell_size);
+					while(kernel.level < max_levels && cell_size / (2 << kernel.level) >= smallest) ++kernel.level;
+					highest = std::max(highest, kernel.level);
+				}
+			}
+		}, table);
+		return highest;
+	}
+}
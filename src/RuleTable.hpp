@@ -0,0 +1,85 @@
+#pragma once
+
+#include <array>
+#include <vector>
+#include <variant>
+#include <utility>
+#include <cstdint>
+#include <algorithm>
+#include "CoreTypes.hpp"
+#include "Rule.hpp"
+
+/* The rules of a recipe laid out by species (the colours that appear in rules),
+ * for a number of species known at compile time. Simulation picks the table that
+ * fits the recipe once and its force loop is instantiated for every table size,
+ * so finding the rule between two particles is an index instead of a walk over all the rules.
+ */
+
+namespace rule_table {
+	const int max_species = 8;
+
+	// a rule with everything in Simulation::calculate_force() that doesn't depend on the distance worked out beforehand
+	struct Kernel {
+		float first_cut;
+		// second_cut; 0 for rules that are never applied
+		float reach;
+		// negative for rules that are never applied, so that every distance is out of reach
+		float second_cut_squared;
+		float peak;
+		// past first_cut the force is `outer_peak - distance * slope`
+		float outer_peak;
+		float slope;
+		// level of the grid (see ParticleGrid::set_levels()) neighbours are looked up at; set by set_levels()
+		int level;
+	};
+
+	// the same as Simulation::calculate_force() for distances in reach
+	inline float force(const Kernel& kernel, float distance) {
+		if(distance < kernel.first_cut) return std::min(kernel.first_cut / distance - 1 + kernel.peak, 1.f);
+		return kernel.outer_peak - distance * kernel.slope;
+	}
+
+	template<int Species>
+	struct Table {
+		static_assert(Species > 0 && Species <= max_species);
+
+		std::array<core::Color, Species> colors;
+		std::array<Kernel, Species * Species> kernels;
+
+		const Kernel& get(int species1, int species2) const {
+			return kernels[species1 * Species + species2];
+		}
+
+		// -1 for colours that no rule mentions
+		int species_of(core::Color color) const {
+			return find(color, std::make_integer_sequence<int, Species>());
+		}
+
+	private:
+		// unrolled compare against every colour
+		template<int... Index>
+		int find(core::Color color, std::integer_sequence<int, Index...>) const {
+			int species = -1;
+			((species = colors[Index] == color ? Index : species), ...);
+			return species;
+		}
+	};
+
+	// monostate when no table fits the rules and Simulation goes through them one by one
+	using AnyTable = std::variant<std::monostate,
+		Table<1>, Table<2>, Table<3>, Table<4>, Table<5>, Table<6>, Table<7>, Table<8>>;
+
+	// false for rules that don't push or pull at any distance
+	bool does_something(const Rule& rule);
+	Kernel make_kernel(const Rule& rule);
+
+	// monostate if the rules have more than max_species colours or some pair of colours has more than one rule
+	AnyTable make(const std::vector<Rule>& rules);
+	// the colours of the species in the order of the table; empty for monostate
+	std::vector<core::Color> colors_of(const AnyTable& table);
+	// gives every kernel the level of a grid with `cell_size` cells that fits its reach best: the most times
+	// the cells can be halved with subcells at least twice as wide as the reach and `min_cell_size`.
+	// That's at most 2x2 subcells per query; smaller ones would mean more ranges than particles saved
+	// Returns the highest level given out
+	int set_levels(AnyTable& table, float cell_size, float min_cell_size, int max_levels);
+}
@@ -0,0 +1,17 @@
+#pragma once
+
+#include <SFML/Graphics.hpp>
+#include "CoreTypes.hpp"
+
+// the simulation's types (see CoreTypes.hpp) to SFML's and back, for the window and the frame export
+namespace sfml_types {
+	inline sf::Vector2f to_sf(core::Vector2f vector) { return { vector.x, vector.y }; }
+	inline sf::Vector2i to_sf(core::Vector2i vector) { return { vector.x, vector.y }; }
+	inline sf::Color to_sf(core::Color color) { return { color.r, color.g, color.b, color.a }; }
+	inline sf::FloatRect to_sf(core::FloatRect rect) { return { rect.left, rect.top, rect.width, rect.height }; }
+
+	inline core::Vector2f to_core(sf::Vector2f vector) { return { vector.x, vector.y }; }
+	inline core::Vector2i to_core(sf::Vector2i vector) { return { vector.x, vector.y }; }
+	inline core::Color to_core(sf::Color color) { return { color.r, color.g, color.b, color.a }; }
+	inline core::FloatRect to_core(sf::FloatRect rect) { return { rect.left, rect.top, rect.width, rect.height }; }
+}
@@ -2,6 +2,13 @@
 #include <random>
 #include <cmath>
 #include <fstream>
+#include <algorithm>
+#include <limits>
+#include "Trace.hpp"
+#include "Recording.hpp"
+#include "FrameArena.hpp"
+
+using std::chrono::steady_clock;
 
 #if __has_include(<omp.h>)
 	#define OMP_PRESENT
@@ -16,20 +23,49 @@ void float_bandaid(float& val) {
 	if(std::isnan(val) || std::isinf(val)) val = 0;
 }
 
-Simulation::Simulation(const Recipe& recipe, int threads, bool cpu_is_big_endian):
+Simulation::Simulation(const Recipe& recipe, int threads, bool cpu_is_big_endian, std::optional<std::uint32_t> seed):
 	cpu_is_big_endian(cpu_is_big_endian),
-	particles({0, 0}, 1)
+	record_in_id_order(false),
+	step_count(0),
+	next_particle_id(0),
+	random_engine(std::random_device()()),
+	grid_levels(0),
+	max_grid_levels(ParticleGrid::max_levels),
+	cell_order(ParticleGrid::CellOrder::Rows),
+	particles({0, 0}, 1),
+	sleep_speed(0),
+	sleep_after(0),
+	sleep_active(false),
+	sleep_stats { 0, 0, 0 },
+	far_field(0),
+	load_tracking(false),
+	cell_pairs_counted(false)
 {
 	#ifdef OMP_PRESENT
 		if(threads != 0) omp_set_num_threads(threads);
 	#endif
 
+	// through seed_seq so that neighbouring seeds (and 0) give unrelated sequences
+	if(seed.has_value()) {
+		std::seed_seq seed_sequence { seed.value() };
+		random_engine.seed(seed_sequence);
+	}
+
+	// the grid depends on the rules and the number of particles
+	// so particles are added once everything else is known
+	std::size_t particle_count = 0;
+
 	for(const auto& step : recipe.get_steps()) {
 		if(std::holds_alternative<Recipe::Window>(step)) {
 			auto window = std::get<Recipe::Window>(step);
-			board_size.x = window.width;
-			board_size.y = window.height;
-			particles = ParticleGrid({window.width, window.height}, 30);
+			window_size.x = window.width;
+			window_size.y = window.height;
+			board_size = window_size;
+		}
+		else if(std::holds_alternative<Recipe::World>(step)) {
+			auto world = std::get<Recipe::World>(step);
+			board_size.x = world.width;
+			board_size.y = world.height;
 		}
 		else if(std::holds_alternative<Recipe::Friction>(step)) {
 			auto friction_struct = std::get<Recipe::Friction>(step);
@@ -37,42 +73,139 @@ Simulation::Simulation(const Recipe& recipe, int threads, bool cpu_is_big_endian
 		}
 		else if(std::holds_alternative<Recipe::Particles>(step)) {
 			auto parts = std::get<Recipe::Particles>(step);
-			add_random_particles(parts.amount, parts.color);
+			particle_count += std::max(parts.amount, 0);
 		}
 		else if(std::holds_alternative<Rule>(step)) {
 			auto rule = std::get<Rule>(step);
 			add_rule(rule);
 		}
+		else if(std::holds_alternative<Recipe::Emitter>(step)) {
+			auto emitter = std::get<Recipe::Emitter>(step);
+			emitters.push_back(Flow { emitter.color, emitter.area, emitter.rate, 0 });
+		}
+		else if(std::holds_alternative<Recipe::Sink>(step)) {
+			auto sink = std::get<Recipe::Sink>(step);
+			sinks.push_back(Flow { sink.color, sink.area, sink.rate, 0 });
+		}
+	}
+
+	// rules much shorter than the longest one look up their neighbours in smaller subcells of the grid
+	rules_by_species = rule_table::make(rules);
+	grid_levels = rule_table::set_levels(rules_by_species, std::max(largest_radius() / 2, min_cell_size), min_cell_size, ParticleGrid::max_levels);
+	particles = make_grid(particle_count);
+
+	for(const auto& step : recipe.get_steps()) {
+		if(std::holds_alternative<Recipe::Particles>(step)) {
+			auto parts = std::get<Recipe::Particles>(step);
+			add_random_particles(parts.amount, parts.color);
+		}
+	}
+
+	particles.sort();
+	particles.spread_over_threads();
+}
+
+float Simulation::largest_radius() const {
+	float largest = 0;
+	for(const auto& rule : rules) largest = std::max(largest, rule.second_cut);
+	return largest;
+}
+
+ParticleGrid Simulation::make_grid(std::size_t particle_count) const {
+	// cells half as wide as the longest interaction radius,
+	// so that a neighbourhood query covers about 5x5 cells
+	float radius = largest_radius();
+	if(radius <= 0) return ParticleGrid(board_size, 30);
+
+	float cell_size = std::max(radius / 2, min_cell_size);
+
+	// most cells would be empty on a sparsely populated board;
+	// then only the occupied ones are kept track of
+	double particles_at_least_one = std::max<std::size_t>(particle_count, 1);
+	double cell_count = std::ceil(board_size.x / cell_size) * std::ceil(board_size.y / cell_size);
+	auto cell_index = ParticleGrid::CellIndex::Dense;
+	if(cell_count > sparse_cells_per_particle * particles_at_least_one) {
+		cell_index = ParticleGrid::CellIndex::Sparse;
+	}
+
+	// every species and level multiplies the keys a sort goes through, however many particles there are;
+	// levels are only worth it while that stays small next to the particles
+	auto colors = rule_table::colors_of(rules_by_species);
+	int species_count = std::min<int>(colors.size(), ParticleGrid::max_species) + 1;
+	double max_keys = dense_keys_per_particle * particles_at_least_one;
+	int levels = std::min(grid_levels, max_grid_levels);
+	while(levels > 0 && ParticleGrid::dense_key_count(board_size, cell_size, cell_order, species_count, levels) > max_keys) {
+		--levels;
+	}
+	if(ParticleGrid::dense_key_count(board_size, cell_size, cell_order, species_count, 0) > max_keys) {
+		cell_index = ParticleGrid::CellIndex::Sparse;
 	}
 
-	particles.init_new_with_old();
+	ParticleGrid grid(board_size, cell_size, cell_index, cell_order);
+	// sparse grids have no levels, so every rule works on whole cells there
+	grid.set_levels(levels);
+	// the force loop goes through the particles of every species separately
+	grid.set_species(colors);
+	grid.keep_aggregates(far_field > 0);
+	return grid;
 }
 
 const ParticleGrid& Simulation::get_particles() const {
 	return particles;
 }
 
-const sf::Vector2i Simulation::get_board_size() const {
+const core::Vector2i Simulation::get_board_size() const {
 	return board_size;
 }
 
-void Simulation::add_particle(const Particle& particle) {
+const core::Vector2i Simulation::get_window_size() const {
+	return window_size;
+}
+
+std::uint32_t Simulation::take_particle_id() {
+	if(free_particle_ids.empty()) return next_particle_id++;
+
+	auto id = free_particle_ids.back();
+	free_particle_ids.pop_back();
+	return id;
+}
+
+void Simulation::add_particle(Particle particle) {
 	if(particle.position.x > 0 && particle.position.y > 0 &&
 	   particle.position.x < board_size.x && particle.position.y < board_size.y) {
-		particles.insert(particle);
+		particle.id = take_particle_id();
+		particles.append(particle);
 	}
 }
 
-void Simulation::add_random_particles(int amount, sf::Color color) {
-	std::random_device random_dev;
-	auto seed = random_dev();
+void Simulation::add_particles(const std::vector<Particle>& new_particles) {
+	// the population can change a lot so the grid is chosen again
+	auto old_particles = particles.get_particles();
+	particles = make_grid(old_particles.size() + new_particles.size());
 
-	std::default_random_engine eng(seed);
+	for(const auto& particle : old_particles) particles.append(particle);
+	for(const auto& particle : new_particles) add_particle(particle);
+
+	particles.sort();
+	particles.spread_over_threads();
+}
+
+void Simulation::set_cell_order(ParticleGrid::CellOrder order) {
+	cell_order = order;
+	add_particles({});
+}
+
+void Simulation::set_max_grid_levels(int levels) {
+	max_grid_levels = levels;
+	add_particles({});
+}
+
+void Simulation::add_random_particles(int amount, core::Color color) {
 	auto x_dist = std::uniform_real_distribution<float>(0, board_size.x);
 	auto y_dist = std::uniform_real_distribution<float>(0, board_size.y);
 
 	for(int i=0; i<amount; ++i) {
-		add_particle(Particle({x_dist(eng), y_dist(eng)}, {0, 0}, color));
+		add_particle(Particle({x_dist(random_engine), y_dist(random_engine)}, {0, 0}, color));
 	}
 }
 
@@ -112,7 +245,7 @@ void Simulation::execute_rule(const Rule& rule, Particle& particle1, const Parti
 	particle1.velocity.y += force_y;
 }
 
-sf::Vector2f Simulation::apply_friction(sf::Vector2f velocity) {
+core::Vector2f Simulation::apply_friction(core::Vector2f velocity) {
 	velocity.x *= (1.f - friction);
 	velocity.y *= (1.f - friction);
 	return velocity;
@@ -139,58 +272,529 @@ void Simulation::fix_particle(Particle& particle) {
 }
 
 void Simulation::update() {
-	const auto& old_particles = particles.get_particles();
-	auto& new_particles = particles.get_mut_new_particles();
+	update(1);
+}
+
+void Simulation::update(int steps) {
+	run_steps(steps, std::nullopt);
+}
+
+int Simulation::update_for(steady_clock::duration budget) {
+	return run_steps(std::numeric_limits<int>::max(), steady_clock::now() + budget);
+}
+
+int Simulation::run_steps(int max_steps, std::optional<steady_clock::time_point> deadline) {
+	trace::Span update_span("update");
+
+	int steps_done = 0;
+	bool keep_going = max_steps > 0;
+	auto step_start = steady_clock::now();
+
+	// nested inside another parallel region this simulation gets a single thread,
+	// whatever the OpenMP nesting settings are
+	[[maybe_unused]] bool nested = false;
+	#ifdef OMP_PRESENT
+		nested = omp_in_parallel();
+	#endif
+
+	prepare_sleeping();
+	prepare_load_tracking();
+	if(particles.needs_spreading()) particles.spread_over_threads();
+	resize_accelerations();
+
+	// a single parallel region for all the steps so the threads don't get
+	// released and woken up again between them
+	#pragma omp parallel if(!nested)
+	{
+		while(keep_going) {
+			// nothing allocated in the arenas lives longer than a step
+			frame_arena::reset_local();
+			update_sleeping();
+			reset_load();
+			move_particles();
+
+			// every force is worked out from where the particles were before any of them moves
+			#pragma omp barrier
+			integrate();
+
+			#pragma omp single
+			{
+				{
+					trace::Span sort_span("sort");
+					apply_flows();
+					particles.sort();
+					resize_accelerations();
+				}
+
+				++steps_done;
+				++step_count;
+
+				// stop if the next step most likely won't fit before the deadline
+				auto now = steady_clock::now();
+				auto step_time = now - step_start;
+				step_start = now;
+
+				keep_going = steps_done < max_steps;
+				if(deadline.has_value() && now + step_time > deadline.value()) keep_going = false;
+			}
+
+			// emitters made the vector grow on a single thread; every thread gets its part back
+			if(particles.needs_spreading()) particles.spread_over_team();
+		}
+	}
+
+	return steps_done;
+}
+
+// queues spawning and removing particles for emitters and sinks;
+// the grid applies all of it at once when it's sorted
+void Simulation::apply_flows() {
+	if(emitters.empty() && sinks.empty()) return;
+
+	const auto& particle_vec = particles.get_particles();
+	removed_ids.clear();
+
+	for(auto& sink : sinks) {
+		sink.credit += sink.rate;
+
+		for(const auto& range : particles.get_ranges_in(sink.area)) {
+			for(std::size_t i = range.first; i < range.second && sink.credit >= 1; ++i) {
+				const auto& particle = particle_vec[i];
+				if(particle.color != sink.color || !sink.area.contains(particle.position)) continue;
+				removed_ids.push_back(particle.id);
+				sink.credit -= 1;
+			}
+		}
+
+		// no saving up while there's nothing to remove
+		sink.credit -= std::floor(sink.credit);
+	}
+
+	// overlapping sinks can pick the same particle
+	std::sort(removed_ids.begin(), removed_ids.end());
+	removed_ids.erase(std::unique(removed_ids.begin(), removed_ids.end()), removed_ids.end());
 
-	#pragma omp parallel for
-	for(int i=0; i<new_particles.size(); ++i) {
-		auto& particle1 = new_particles[i];
-		particle1 = old_particles[i];
+	const auto& indices_by_id = particles.get_indices_by_id();
+	for(auto id : removed_ids) {
+		particles.queue_remove(indices_by_id[id]);
+		free_particle_ids.push_back(id);
+	}
+
+	for(auto& emitter : emitters) {
+		emitter.credit += emitter.rate;
+
+		auto x_dist = std::uniform_real_distribution<float>(emitter.area.left, emitter.area.left + emitter.area.width);
+		auto y_dist = std::uniform_real_distribution<float>(emitter.area.top, emitter.area.top + emitter.area.height);
+
+		for(; emitter.credit >= 1; emitter.credit -= 1) {
+			auto position = core::Vector2f(x_dist(random_engine), y_dist(random_engine));
+			if(position.x <= 0 || position.y <= 0 || position.x >= board_size.x || position.y >= board_size.y) continue;
+			particles.queue_append(Particle(position, {0, 0}, emitter.color, take_particle_id()));
+		}
+	}
+}
+
+template<int Species>
+void Simulation::move_particles_with(const rule_table::Table<Species>& table) {
+	// nowait so that the span ends when this thread runs out of work
+	// instead of hiding the imbalance in the barrier
+	trace::Span thread_span("force loop");
+
+	const auto& particle_vec = particles.get_particles();
+	bool far_field_active = far_field > 0 && particles.get_cell_index() == ParticleGrid::CellIndex::Dense;
+	// kernels can ask for finer levels than make_grid() allowed; those work on the finest one there is
+	int grid_levels_kept = particles.get_levels();
+	// one for all the queries of this thread
+	ParticleGrid::Ranges ranges(frame_arena::local());
+
+	// static to match the split of ParticleGrid::spread_over_threads(), which puts the particles
+	// in the memory of the threads that work on them
+	#pragma omp for schedule(static) nowait
+	for(int i=0; i<static_cast<int>(particle_vec.size()); ++i) {
+		const auto& particle1 = particle_vec[i];
+		auto& acceleration = accelerations[i];
+		acceleration = {0, 0};
+		if(sleep_active && is_asleep(particle1)) continue;
+
+		int species1 = table.species_of(particle1.color);
+		std::uint32_t pairs = 0;
+
+		// every rule of the particle only looks at the particles of its own species in its own radius
+		for(int species2 = 0; species1 >= 0 && species2 < Species; ++species2) {
+			const auto& kernel = table.get(species1, species2);
+			if(kernel.reach <= 0) continue;
+
+			if(far_field_active && std::min(kernel.level, grid_levels_kept) == 0) {
+				pairs += apply_far_field(particle1, kernel, species2, acceleration);
+				continue;
+			}
+
+			auto relevant_area = core::FloatRect(
+					particle1.position.x - kernel.reach,
+					particle1.position.y - kernel.reach,
+					kernel.reach * 2,
+					kernel.reach * 2);
+
+			particles.get_ranges_in(relevant_area, ranges, species2, kernel.level);
+			for(const auto& range : ranges) {
+				pairs += range.second - range.first;
+				for(std::size_t j = range.first; j < range.second; ++j) {
+					const auto& particle2 = particle_vec[j];
+					float distance_x = particle1.position.x - particle2.position.x;
+					float distance_y = particle1.position.y - particle2.position.y;
+					float distance_squared = distance_x*distance_x + distance_y*distance_y;
+					// out of reach without taking the square root; 0 is particle1 itself
+					if(distance_squared > kernel.second_cut_squared || distance_squared == 0) continue;
+
+					float distance = std::sqrt(distance_squared);
+					float force = rule_table::force(kernel, distance) / distance;
+					acceleration.x += force * distance_x;
+					acceleration.y += force * distance_y;
+				}
+			}
+		}
+
+		if(cell_pairs_counted) count_pairs(particle1.position, pairs);
+	}
+}
+
+std::uint32_t Simulation::apply_far_field(
+		const Particle& particle1,
+		const rule_table::Kernel& kernel,
+		int species,
+		core::Vector2f& acceleration
+) const {
+	const auto& particle_vec = particles.get_particles();
+	auto cell_size = particles.get_cell_size();
+	auto first_cell = particles.get_cell_of(particle1.position - core::Vector2f(kernel.reach, kernel.reach));
+	auto last_cell = particles.get_cell_of(particle1.position + core::Vector2f(kernel.reach, kernel.reach));
+	float near = far_field * kernel.reach;
+	float near_squared = near * near;
+	std::uint32_t pairs = 0;
+
+	for(int y = first_cell.y; y <= last_cell.y; ++y) {
+		// how far the particle is from the nearest point of the cell; 0 inside of it
+		float cell_distance_y = std::max({y * cell_size.y - particle1.position.y, 0.f, particle1.position.y - (y + 1) * cell_size.y});
+
+		for(int x = first_cell.x; x <= last_cell.x; ++x) {
+			float cell_distance_x = std::max({x * cell_size.x - particle1.position.x, 0.f, particle1.position.x - (x + 1) * cell_size.x});
+
+			// the particle's own cell is never far, so it doesn't have to be skipped here
+			if(cell_distance_x*cell_distance_x + cell_distance_y*cell_distance_y > near_squared) {
+				const auto& aggregate = particles.get_aggregate({x, y}, species);
+				if(aggregate.count == 0) continue;
+				++pairs;
+
+				float distance_x = particle1.position.x - aggregate.centroid.x;
+				float distance_y = particle1.position.y - aggregate.centroid.y;
+				float distance_squared = distance_x*distance_x + distance_y*distance_y;
+				if(distance_squared > kernel.second_cut_squared || distance_squared == 0) continue;
+
+				float distance = std::sqrt(distance_squared);
+				float force = aggregate.count * rule_table::force(kernel, distance) / distance;
+				acceleration.x += force * distance_x;
+				acceleration.y += force * distance_y;
+				continue;
+			}
+
+			auto range = particles.get_cell_range({x, y}, species);
+			pairs += range.second - range.first;
+			for(std::size_t j = range.first; j < range.second; ++j) {
+				const auto& particle2 = particle_vec[j];
+				float distance_x = particle1.position.x - particle2.position.x;
+				float distance_y = particle1.position.y - particle2.position.y;
+				float distance_squared = distance_x*distance_x + distance_y*distance_y;
+				if(distance_squared > kernel.second_cut_squared || distance_squared == 0) continue;
+
+				float distance = std::sqrt(distance_squared);
+				float force = rule_table::force(kernel, distance) / distance;
+				acceleration.x += force * distance_x;
+				acceleration.y += force * distance_y;
+			}
+		}
+	}
+
+	return pairs;
+}
+
+void Simulation::move_particles_with(std::monostate) {
+	trace::Span thread_span("force loop");
+
+	const auto& particle_vec = particles.get_particles();
+	ParticleGrid::Ranges ranges(frame_arena::local());
+
+	#pragma omp for schedule(static) nowait
+	for(int i=0; i<static_cast<int>(particle_vec.size()); ++i) {
+		accelerations[i] = {0, 0};
+		if(sleep_active && is_asleep(particle_vec[i])) continue;
+		std::uint32_t pairs = 0;
+
+		// execute_rule() adds to the velocity of a copy, which then holds the acceleration
+		auto particle1 = particle_vec[i];
+		particle1.velocity = {0, 0};
 
 		for(const auto& rule : rules) {
 			if(rule.particle1_color != particle1.color) continue;
 
-			auto relevant_area = sf::FloatRect(
+			auto relevant_area = core::FloatRect(
 					particle1.position.x - rule.second_cut,
 					particle1.position.y - rule.second_cut,
 					rule.second_cut * 2,
 					rule.second_cut * 2);
 
-			auto ranges = particles.get_ranges_in(relevant_area);
+			particles.get_ranges_in(relevant_area, ranges);
 			for(const auto& range : ranges) {
+				pairs += range.second - range.first;
 				for(std::size_t j = range.first; j < range.second; ++j) {
-					const auto& particle2 = old_particles[j];
-					if(particle1 == particle2) continue;
+					if(j == static_cast<std::size_t>(i)) continue;
+					const auto& particle2 = particle_vec[j];
 					if(rule.particle2_color != particle2.color) continue;
 					execute_rule(rule, particle1, particle2);
 				}
 			}
 		}
 
-		perform_movement(particle1);
+		accelerations[i] = particle1.velocity;
+		if(cell_pairs_counted) count_pairs(particle1.position, pairs);
 	}
+}
 
-	particles.swap_vecs();
-	particles.sort();
+// called by every thread of the parallel region, once all the forces are known
+void Simulation::integrate() {
+	auto& particle_vec = particles.get_mut_particles();
+
+	// the same split as the force loop, so every thread moves the particles it has just worked on
+	#pragma omp for schedule(static)
+	for(int i=0; i<static_cast<int>(particle_vec.size()); ++i) {
+		auto& particle = particle_vec[i];
+		// sleeping particles stand still, keeping their velocity
+		if(sleep_active && is_asleep(particle)) continue;
+
+		particle.velocity += accelerations[i];
+		perform_movement(particle);
+	}
+}
+
+void Simulation::resize_accelerations() {
+	auto size = particles.get_particles().size();
+	if(size <= accelerations.capacity()) {
+		accelerations.resize(size);
+		return;
+	}
+
+	// the old values are never read again, so rather than copying them over on this thread
+	// the new buffer is left for the force loop to touch first, each thread its own part
+	decltype(accelerations) grown;
+	grown.resize(size);
+	accelerations.swap(grown);
 }
 
-void Simulation::init_recording(std::ofstream& out) const {
-	std::size_t particle_count = particles.get_particles().size();
-	out.write(reinterpret_cast<const char*>(&board_size.x), sizeof(sf::Int32));
-	out.write(reinterpret_cast<const char*>(&board_size.y), sizeof(sf::Int32));
-	out.write(reinterpret_cast<const char*>(&particle_count), sizeof(sf::Int32));
+void Simulation::enable_sleeping(float speed, int after) {
+	sleep_speed = speed;
+	sleep_after = std::clamp(after, 1, static_cast<int>(UINT16_MAX));
+}
+
+const Simulation::SleepStats& Simulation::get_sleep_stats() const {
+	return sleep_stats;
+}
+
+void Simulation::enable_far_field(float near_fraction) {
+	far_field = std::max(near_fraction, 0.f);
+	particles.keep_aggregates(far_field > 0);
+}
+
+// called before the parallel region of every update
+void Simulation::prepare_sleeping() {
+	sleep_active = sleep_speed > 0 && particles.get_cell_index() == ParticleGrid::CellIndex::Dense;
+	if(!sleep_active) return;
+
+	auto grid_size = particles.get_grid_size();
+	std::size_t cell_count = static_cast<std::size_t>(grid_size.x) * grid_size.y;
+	if(cell_counts.size() == cell_count) return;
+
+	// a new grid; everything starts awake
+	cell_counts.assign(cell_count, 0);
+	cell_speed_sums.assign(cell_count, 0);
+	cell_changed.assign(cell_count, 1);
+	cell_quiet_steps.assign(cell_count, 0);
 }
 
-void Simulation::record(std::ofstream& out) const {
-	for(const auto& particle : particles.get_particles()) {
-		if(cpu_is_big_endian) {
-			// convert to little endian (not tested)
-			auto* ptr = reinterpret_cast<const char*>(&particle);
-			for(int i = sizeof(Particle) - 1; i >= 0; --i) {
-				out.write(ptr + i, 1);
+// called by every thread of the parallel region, before the force loop
+void Simulation::update_sleeping() {
+	if(!sleep_active) return;
+
+	const auto& particle_vec = particles.get_particles();
+	auto grid_size = particles.get_grid_size();
+	int cell_count = grid_size.x * grid_size.y;
+
+	// what changed in every cell during the last step
+	#pragma omp for schedule(static)
+	for(int cell=0; cell<cell_count; ++cell) {
+		auto range = particles.get_cell_range({cell % grid_size.x, cell / grid_size.x});
+
+		float fastest = 0;
+		float speed_sum = 0;
+		for(std::size_t i = range.first; i < range.second; ++i) {
+			const auto& velocity = particle_vec[i].velocity;
+			float speed = std::sqrt(velocity.x*velocity.x + velocity.y*velocity.y);
+			fastest = std::max(fastest, speed);
+			speed_sum += speed;
+		}
+
+		std::uint32_t count = range.second - range.first;
+		cell_changed[cell] = fastest >= sleep_speed || count != cell_counts[cell];
+		cell_counts[cell] = count;
+		cell_speed_sums[cell] = speed_sum;
+	}
+
+	// a cell falls asleep after sleep_after steps of nothing changing in it and the cells next to it
+	// and wakes up as soon as something does
+	#pragma omp for schedule(static)
+	for(int cell=0; cell<cell_count; ++cell) {
+		int x = cell % grid_size.x;
+		int y = cell / grid_size.x;
+
+		bool quiet = true;
+		for(int near_y = std::max(0, y - 1); quiet && near_y <= std::min(grid_size.y - 1, y + 1); ++near_y) {
+			for(int near_x = std::max(0, x - 1); near_x <= std::min(grid_size.x - 1, x + 1); ++near_x) {
+				if(!cell_changed[near_y * grid_size.x + near_x]) continue;
+				quiet = false;
+				break;
 			}
-		} else {
-			out.write(reinterpret_cast<const char*>(&particle), sizeof(Particle));
 		}
+
+		if(!quiet) cell_quiet_steps[cell] = 0;
+		else if(cell_quiet_steps[cell] < sleep_after) ++cell_quiet_steps[cell];
+	}
+
+	#pragma omp single
+	{
+		std::size_t occupied_cells = 0;
+		std::size_t asleep_cells = 0;
+		std::size_t asleep_particles = 0;
+		float skipped_motion = 0;
+
+		for(int cell=0; cell<cell_count; ++cell) {
+			if(cell_counts[cell] == 0) continue;
+			++occupied_cells;
+			if(cell_quiet_steps[cell] < sleep_after) continue;
+			++asleep_cells;
+			asleep_particles += cell_counts[cell];
+			skipped_motion += cell_speed_sums[cell];
+		}
+
+		float asleep_fraction = occupied_cells == 0 ? 0 : static_cast<float>(asleep_cells) / occupied_cells;
+		sleep_stats = SleepStats { asleep_fraction, asleep_particles, skipped_motion };
 	}
 }
+
+bool Simulation::is_asleep(const Particle& particle) const {
+	auto cell = particles.get_cell_of(particle.position);
+	std::size_t index = static_cast<std::size_t>(particles.get_grid_size().x) * cell.y + cell.x;
+	return cell_quiet_steps[index] >= sleep_after;
+}
+
+void Simulation::enable_load_tracking(bool enabled) {
+	load_tracking = enabled;
+}
+
+const std::vector<std::uint32_t>& Simulation::get_cell_pairs() const {
+	return cell_pairs;
+}
+
+const std::vector<float>& Simulation::get_thread_busy_ms() const {
+	return thread_busy_ms;
+}
+
+// called before the parallel region of every update
+void Simulation::prepare_load_tracking() {
+	cell_pairs_counted = load_tracking && particles.get_cell_index() == ParticleGrid::CellIndex::Dense;
+	if(!load_tracking) thread_busy_ms.clear();
+	if(!cell_pairs_counted) {
+		cell_pairs.clear();
+		return;
+	}
+
+	auto grid_size = particles.get_grid_size();
+	cell_pairs.resize(static_cast<std::size_t>(grid_size.x) * grid_size.y);
+}
+
+// called by every thread of the parallel region, before the force loop
+void Simulation::reset_load() {
+	if(!load_tracking) return;
+
+	#pragma omp single
+	{
+		std::fill(cell_pairs.begin(), cell_pairs.end(), 0);
+
+		int threads = 1;
+		#ifdef OMP_PRESENT
+			threads = omp_get_num_threads();
+		#endif
+		thread_busy_ms.assign(threads, 0);
+	}
+}
+
+void Simulation::count_pairs(core::Vector2f position, std::uint32_t pairs) {
+	// particles are sorted by cell, so threads only share the cells at the edges of their parts
+	auto cell = particles.get_cell_of(position);
+	auto& count = cell_pairs[static_cast<std::size_t>(particles.get_grid_size().x) * cell.y + cell.x];
+	#pragma omp atomic
+	count += pairs;
+}
+
+// called by every thread of the parallel region
+void Simulation::move_particles() {
+	if(!load_tracking) {
+		std::visit([this](const auto& table) { move_particles_with(table); }, rules_by_species);
+		return;
+	}
+
+	auto start = steady_clock::now();
+	std::visit([this](const auto& table) { move_particles_with(table); }, rules_by_species);
+
+	int thread = 0;
+	#ifdef OMP_PRESENT
+		thread = omp_get_thread_num();
+	#endif
+	thread_busy_ms[thread] = std::chrono::duration<float, std::milli>(steady_clock::now() - start).count();
+}
+
+std::uint64_t Simulation::get_step_count() const {
+	return step_count;
+}
+
+bool Simulation::has_variable_population() const {
+	return !emitters.empty() || !sinks.empty();
+}
+
+void Simulation::init_recording(std::ofstream& out, bool in_id_order) {
+	record_in_id_order = in_id_order;
+
+	std::int32_t particle_count = particles.get_particles().size();
+	if(has_variable_population()) particle_count = recording::variable_particle_count;
+	recording::write_header(out, board_size, particle_count, cpu_is_big_endian);
+}
+
+void Simulation::record(std::ofstream& out) {
+	const auto& particle_vec = particles.get_particles();
+	record_buffer.clear();
+
+	if(has_variable_population()) {
+		recording::append_particle_count(record_buffer, particle_vec.size(), cpu_is_big_endian);
+	}
+
+	if(record_in_id_order) {
+		// the same particle is at the same place in every frame
+		for(auto index : particles.get_indices_by_id()) {
+			if(index == ParticleGrid::no_index) continue;
+			recording::append_particle(record_buffer, particle_vec[index], cpu_is_big_endian);
+		}
+	} else {
+		for(const auto& particle : particle_vec) {
+			recording::append_particle(record_buffer, particle, cpu_is_big_endian);
+		}
+	}
+
+	out.write(record_buffer.data(), record_buffer.size());
+}
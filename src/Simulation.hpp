@@ -6,33 +6,172 @@
 #include <atomic>
 #include <utility>
 #include <condition_variable>
+#include <chrono>
+#include <optional>
+#include <random>
 #include "ParticleGrid.hpp"
 #include "Recipe.hpp"
+#include "RuleTable.hpp"
 
 class Simulation {
+public:
+	struct SleepStats {
+		// of the cells with particles in them
+		float asleep_fraction;
+		std::size_t asleep_particles;
+		// how far the sleeping particles would have moved during the last step at the speed they fell asleep with,
+		// all together; it's what sleeping gets wrong, and no particle adds more than the sleep speed to it
+		float skipped_motion;
+	};
+
+private:
+	const float min_cell_size = 8;
+	// more cells than that per particle and the grid only keeps track of the occupied ones
+	const double sparse_cells_per_particle = 4;
+	// dense grids clear and count every key (cell, species and subcell) on every sort;
+	// past that many per particle they get fewer levels, or only keep the occupied cells
+	const double dense_keys_per_particle = 64;
+
 	bool cpu_is_big_endian; // for recording
+	bool record_in_id_order;
+	std::vector<char> record_buffer;
+	std::uint64_t step_count;
+	std::uint32_t next_particle_id;
+	// ids of removed particles, given to new ones
+	std::vector<std::uint32_t> free_particle_ids;
+
+	// emitters and sinks; `credit` carries the fractional part of the rate over to the next step
+	struct Flow {
+		core::Color color;
+		core::FloatRect area;
+		float rate;
+		float credit;
+	};
+	std::vector<Flow> emitters;
+	std::vector<Flow> sinks;
+	std::vector<std::uint32_t> removed_ids;
+	// for the initial particles and emitters
+	std::default_random_engine random_engine;
 	float friction;
-	sf::Vector2i board_size;
+	core::Vector2i board_size;
+	core::Vector2i window_size;
 	std::vector<Rule> rules;
+	// picked once the recipe is loaded; decides which force loop runs
+	rule_table::AnyTable rules_by_species;
+	// levels of the grid the rules of rules_by_species need; make_grid() may give it fewer
+	int grid_levels;
+	// see set_max_grid_levels()
+	int max_grid_levels;
+	ParticleGrid::CellOrder cell_order;
 	ParticleGrid particles;
+	// what the force loop adds up for every particle, by its index in the grid; the particles themselves
+	// are only read until all of it is known and then moved in place
+	std::vector<core::Vector2f, ParticleAllocator<core::Vector2f>> accelerations;
+
+	// see enable_sleeping(); everything per cell is indexed row by row
+	float sleep_speed;
+	int sleep_after;
+	// for the current update
+	bool sleep_active;
+	std::vector<std::uint32_t> cell_counts;
+	std::vector<float> cell_speed_sums;
+	std::vector<std::uint8_t> cell_changed;
+	std::vector<std::uint16_t> cell_quiet_steps;
+	SleepStats sleep_stats;
+
+	// see enable_far_field(); 0 when off
+	float far_field;
+
+	// see enable_load_tracking()
+	bool load_tracking;
+	// for the current update; cells are only counted on dense grids
+	bool cell_pairs_counted;
+	std::vector<std::uint32_t> cell_pairs;
+	std::vector<float> thread_busy_ms;
 
-	void add_particle(const Particle& particle);
-	void add_random_particles(int amount, sf::Color color);
+	float largest_radius() const;
+	ParticleGrid make_grid(std::size_t particle_count) const;
+	std::uint32_t take_particle_id();
+	void add_particle(Particle particle);
+	void apply_flows();
+	void add_random_particles(int amount, core::Color color);
 	void add_rule(const Rule& rule);
 
-	float calculate_force(const Rule& rule, float distance);
-	sf::Vector2f apply_friction(sf::Vector2f velocity);
-	void execute_rule(const Rule& rule, Particle& particle1, const Particle& particle2);
+	core::Vector2f apply_friction(core::Vector2f velocity);
 	void perform_movement(Particle& particle);
+	void prepare_sleeping();
+	void update_sleeping();
+	bool is_asleep(const Particle& particle) const;
+	void prepare_load_tracking();
+	void reset_load();
+	void count_pairs(core::Vector2f position, std::uint32_t pairs);
+	// adds the force of `kernel` on `particle1` from the particles of `species` to `acceleration`,
+	// with far cells as single particles; returns the pairs looked at, counting every such cell as one
+	std::uint32_t apply_far_field(
+			const Particle& particle1,
+			const rule_table::Kernel& kernel,
+			int species,
+			core::Vector2f& acceleration) const;
+	void move_particles();
+	template<int Species>
+	void move_particles_with(const rule_table::Table<Species>& table);
+	// goes through all the rules for every particle
+	void move_particles_with(std::monostate);
+	// to the number of particles, without copying the old values when it has to grow
+	void resize_accelerations();
+	// applies the accelerations and moves the particles
+	void integrate();
+	int run_steps(int max_steps, std::optional<std::chrono::steady_clock::time_point> deadline);
 	void fix_particle(Particle& particle);
 
 public:
-	Simulation(const Recipe& recipe, int threads, bool cpu_is_big_endian);
+	// without a seed every run starts differently
+	Simulation(const Recipe& recipe, int threads, bool cpu_is_big_endian, std::optional<std::uint32_t> seed = std::nullopt);
 
 	const ParticleGrid& get_particles() const;
-	const sf::Vector2i get_board_size() const;
+	const core::Vector2i get_board_size() const;
+	const core::Vector2i get_window_size() const;
+	// steps done since the start
+	std::uint64_t get_step_count() const;
+	// true if there are emitters or sinks
+	bool has_variable_population() const;
+
+	// adds particles on top of the ones from the recipe (used by the benchmark)
+	void add_particles(const std::vector<Particle>& new_particles);
+	// rebuilds the grid with cells in the given order
+	void set_cell_order(ParticleGrid::CellOrder order);
+	// rebuilds the grid with at most `levels` levels of subcells; 0 makes every rule work on whole cells
+	void set_max_grid_levels(int levels);
+	// approximation: once nothing in a grid cell and the cells next to it moved at `speed` per step
+	// or faster (and no particle came or went) for `after` steps, the particles of the cell stop
+	// and are left out of the force loop, until something around them changes again.
+	// Only on dense grids (see ParticleGrid::CellIndex)
+	void enable_sleeping(float speed, int after);
+	// as of the last step
+	const SleepStats& get_sleep_stats() const;
+	// approximation: grid cells that are all further from a particle than `near_fraction` of the reach of a rule
+	// act on it like a single particle at the centroid of their particles of the rule's species,
+	// as strong as all of them together. Lower is faster and less accurate, 0 turns it off.
+	// Only for rules that work on whole cells (see rule_table::set_levels()), on dense grids
+	void enable_far_field(float near_fraction);
+	// counts the pairs of particles the force loop looks at in every grid cell and times the loop on every thread;
+	// costs an atomic add per particle, so it's off by default
+	void enable_load_tracking(bool enabled);
+	// pairs looked at during the last step, for particles in every cell, row by row;
+	// empty when not tracking or on sparse grids
+	const std::vector<std::uint32_t>& get_cell_pairs() const;
+	// how long the force loop of the last step kept every thread busy; the rest until the slowest one is done is idle
+	const std::vector<float>& get_thread_busy_ms() const;
+
+	float calculate_force(const Rule& rule, float distance);
+	void execute_rule(const Rule& rule, Particle& particle1, const Particle& particle2);
 
+	// when called from inside a parallel region (see Ensemble) the steps run on the calling thread only
 	void update();
-	void init_recording(std::ofstream& out) const;
-	void record(std::ofstream& out) const;
+	void update(int steps);
+	// does as many steps as fit in `budget` (at least one); returns the number of steps done
+	int update_for(std::chrono::steady_clock::duration budget);
+	// in_id_order: write particles in the order of their ids rather than in the order of the grid
+	void init_recording(std::ofstream& out, bool in_id_order);
+	void record(std::ofstream& out);
 };
@@ -0,0 +1,252 @@
+#include "Sweep.hpp"
+#include <fstream>
+#include <iostream>
+#include <algorithm>
+#include <filesystem>
+#include "Ensemble.hpp"
+#include "strutil.hpp"
+
+#if __has_include(<omp.h>)
+	#define OMP_PRESENT
+	#include <omp.h>
+#endif
+
+float Sweep::Parameter::value(int i) const {
+	if(count == 1) return from;
+	return from + (to - from) * i / (count - 1);
+}
+
+Sweep::Sweep(std::string_view filename):
+	steps(1000),
+	seeds(1),
+	output_path("sweep.csv")
+{
+	std::ifstream file(filename.data());
+	if(!file.is_open()) {
+		errors += "Can't open file: " + std::string(filename) + "\n";
+		return;
+	}
+
+	std::string line_buffer;
+	while(std::getline(file, line_buffer)) {
+		if(line_buffer[0] == '#') continue;
+
+		auto words = Recipe::line_to_words(line_buffer);
+		if(words.empty()) continue;
+
+		if(words[0] == "recipe" && words.size() == 2) {
+			recipe_paths.push_back(words[1]);
+		}
+		else if(words[0] == "directory" && words.size() == 2) {
+			load_directory(words[1]);
+		}
+		else if(words[0] == "output" && words.size() == 2) {
+			output_path = words[1];
+		}
+		else if(words[0] == "steps" && words.size() == 2) {
+			auto maybe_steps = strutil::stoi_positive(words[1]);
+			if(maybe_steps.has_value()) steps = maybe_steps.value();
+			else errors += std::string("\"") + words[1] + "\" is not a positive integer number\n";
+		}
+		else if(words[0] == "seeds" && words.size() == 2) {
+			auto maybe_seeds = strutil::stoi_positive(words[1]);
+			if(maybe_seeds.has_value()) seeds = maybe_seeds.value();
+			else errors += std::string("\"") + words[1] + "\" is not a positive integer number\n";
+		}
+		else if(words[0] == "friction" || words[0] == "peak") {
+			auto maybe_parameter = load_parameter(words);
+			if(maybe_parameter.has_value()) parameters.push_back(maybe_parameter.value());
+		}
+		else {
+			errors += std::string("Can't parse: ") + line_buffer + "\n";
+		}
+	}
+
+	if(recipe_paths.empty()) errors += "No recipes to run\n";
+	if(!errors.empty()) return;
+
+	for(const auto& path : recipe_paths) {
+		auto recipe = Recipe(path);
+		if(!recipe.get_errors().empty()) {
+			errors += "Error loading \"" + path + "\":\n" + recipe.get_errors();
+			continue;
+		}
+		add_runs(path, recipe);
+	}
+}
+
+void Sweep::load_directory(const std::string& path) {
+	std::error_code error;
+	std::vector<std::string> found;
+
+	for(const auto& entry : std::filesystem::directory_iterator(path, error)) {
+		if(entry.is_regular_file() && entry.path().extension() == ".txt") {
+			found.push_back(entry.path().string());
+		}
+	}
+
+	if(error) {
+		errors += "Can't read directory: " + path + "\n";
+		return;
+	}
+
+	std::sort(found.begin(), found.end());
+	recipe_paths.insert(recipe_paths.end(), found.begin(), found.end());
+}
+
+std::optional<Sweep::Parameter> Sweep::load_parameter(const std::vector<std::string>& words) {
+	Parameter parameter;
+	std::size_t value_start = 1;
+
+	if(words[0] == "friction") {
+		parameter.kind = Parameter::Friction;
+		parameter.label = "friction";
+	} else {
+		parameter.kind = Parameter::Peak;
+		if(words.size() != 6) {
+			errors += "Invalid number of arguments for `peak` (5 expected)\n";
+			return std::nullopt;
+		}
+
+		auto maybe_color1 = Recipe::string_to_color(words[1]);
+		auto maybe_color2 = Recipe::string_to_color(words[2]);
+		if(!maybe_color1.has_value() || !maybe_color2.has_value()) {
+			errors += "\"" + words[1] + "\" or \"" + words[2] + "\" is not a valid color\n";
+			return std::nullopt;
+		}
+
+		parameter.color1 = maybe_color1.value();
+		parameter.color2 = maybe_color2.value();
+		parameter.label = "peak " + words[1] + " " + words[2];
+		value_start = 3;
+	}
+
+	if(words.size() != value_start + 3) {
+		errors += "Invalid number of arguments for `" + words[0] + "`\n";
+		return std::nullopt;
+	}
+
+	auto maybe_from = strutil::stof(words[value_start]);
+	auto maybe_to = strutil::stof(words[value_start + 1]);
+	auto maybe_count = strutil::stoi_positive(words[value_start + 2]);
+	if(!maybe_from.has_value() || !maybe_to.has_value() || !maybe_count.has_value()) {
+		errors += "`" + words[0] + "` expects two floating point numbers and a positive integer number\n";
+		return std::nullopt;
+	}
+
+	parameter.from = maybe_from.value();
+	parameter.to = maybe_to.value();
+	parameter.count = maybe_count.value();
+	return parameter;
+}
+
+void Sweep::add_runs(const std::string& recipe_path, const Recipe& base) {
+	// counts up like an odometer through all the combinations of parameter values
+	std::vector<int> indices(parameters.size(), 0);
+
+	while(true) {
+		Recipe recipe;
+		std::string description;
+		bool has_friction = false;
+
+		for(auto step : base.get_steps()) {
+			for(std::size_t p = 0; p < parameters.size(); ++p) {
+				const auto& parameter = parameters[p];
+				float value = parameter.value(indices[p]);
+
+				if(parameter.kind == Parameter::Friction && std::holds_alternative<Recipe::Friction>(step)) {
+					std::get<Recipe::Friction>(step).value = value;
+				}
+				if(parameter.kind == Parameter::Peak && std::holds_alternative<Rule>(step)) {
+					auto& rule = std::get<Rule>(step);
+					if(rule.particle1_color == parameter.color1 && rule.particle2_color == parameter.color2) rule.peak = value;
+				}
+			}
+
+			if(std::holds_alternative<Recipe::Friction>(step)) has_friction = true;
+			recipe.add_step(step);
+		}
+
+		for(std::size_t p = 0; p < parameters.size(); ++p) {
+			const auto& parameter = parameters[p];
+			if(parameter.kind == Parameter::Friction && !has_friction) {
+				recipe.add_step(Recipe::Friction { parameter.value(indices[p]) });
+			}
+
+			if(!description.empty()) description += "; ";
+			description += parameter.label + "=" + std::to_string(parameter.value(indices[p]));
+		}
+
+		for(int seed = 0; seed < seeds; ++seed) {
+			auto seeded_description = description;
+			if(!seeded_description.empty()) seeded_description += "; ";
+			seeded_description += "seed=" + std::to_string(seed);
+			runs.push_back(Run { recipe_path, seeded_description, recipe, static_cast<std::uint32_t>(seed) });
+		}
+
+		std::size_t p = 0;
+		for(; p < parameters.size(); ++p) {
+			if(++indices[p] < parameters[p].count) break;
+			indices[p] = 0;
+		}
+		if(p == parameters.size()) break;
+	}
+}
+
+const std::string& Sweep::get_errors() const {
+	return errors;
+}
+
+const std::vector<Sweep::Run>& Sweep::get_runs() const {
+	return runs;
+}
+
+const std::string& Sweep::get_output_path() const {
+	return output_path;
+}
+
+std::vector<Sweep::Result> Sweep::run(int threads, bool cpu_is_big_endian) const {
+	#ifdef OMP_PRESENT
+		if(threads != 0) omp_set_num_threads(threads);
+	#endif
+
+	Ensemble ensemble;
+	for(const auto& run : runs) ensemble.add(run.recipe, run.seed, cpu_is_big_endian);
+
+	std::size_t finished = 0;
+	ensemble.update(steps, [&](std::size_t i) {
+		++finished;
+		std::cout << "[" << finished << "/" << runs.size() << "] " << runs[i].recipe_path << " " << runs[i].parameters << "\n";
+	});
+
+	std::vector<Result> results;
+	const auto& simulations = ensemble.get_simulations();
+	for(std::size_t i=0; i<runs.size(); ++i) {
+		auto metrics = Metrics(simulations[i].get_particles().get_particles(), simulations[i].get_board_size());
+		results.push_back(Result { runs[i].recipe_path, runs[i].parameters, metrics });
+	}
+	return results;
+}
+
+bool Sweep::write_results(std::vector<Result> results) const {
+	std::stable_sort(results.begin(), results.end(), [](const Result& r1, const Result& r2) {
+		return r1.metrics.score > r2.metrics.score;
+	});
+
+	std::ofstream out(output_path);
+	if(!out.good()) return false;
+
+	out << "rank,score,cluster_count,spatial_entropy,mean_speed,recipe,parameters\n";
+	for(std::size_t i=0; i<results.size(); ++i) {
+		const auto& result = results[i];
+		out << i + 1 << ","
+		    << result.metrics.score << ","
+		    << result.metrics.cluster_count << ","
+		    << result.metrics.spatial_entropy << ","
+		    << result.metrics.mean_speed << ","
+		    << "\"" << result.recipe_path << "\","
+		    << "\"" << result.parameters << "\"\n";
+	}
+
+	return out.good();
+}
@@ -0,0 +1,79 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <optional>
+#include <cstdint>
+#include "CoreTypes.hpp"
+#include "Recipe.hpp"
+#include "Metrics.hpp"
+
+/* A batch of headless simulations, described by a sweep file:
+ *
+ *   recipe path          - a recipe to run (can be repeated)
+ *   directory path       - every `.txt` recipe in the directory
+ *   steps n              - how many steps every simulation runs for
+ *   seeds n              - every combination is run n times with different starting positions
+ *   output path          - where the ranked CSV is written
+ *   friction from to n   - runs every recipe with n frictions between `from` and `to`
+ *   peak color1 color2 from to n
+ *                        - same for the peak of the `color1 color2` rules
+ *
+ * Every combination of the varied parameters is run for every recipe.
+ */
+
+class Sweep {
+public:
+	struct Run {
+		std::string recipe_path;
+		std::string parameters;
+		Recipe recipe;
+		std::uint32_t seed;
+	};
+
+	struct Result {
+		std::string recipe_path;
+		std::string parameters;
+		Metrics metrics;
+	};
+
+private:
+	struct Parameter {
+		enum Kind { Friction, Peak };
+
+		Kind kind;
+		std::string label;
+		core::Color color1;
+		core::Color color2;
+		float from;
+		float to;
+		int count;
+
+		float value(int i) const;
+	};
+
+	std::vector<std::string> recipe_paths;
+	std::vector<Parameter> parameters;
+	std::vector<Run> runs;
+	int steps;
+	int seeds;
+	std::string output_path;
+	std::string errors;
+
+	void load_directory(const std::string& path);
+	std::optional<Parameter> load_parameter(const std::vector<std::string>& words);
+	void add_runs(const std::string& recipe_path, const Recipe& base);
+
+public:
+	Sweep(std::string_view filename);
+
+	const std::string& get_errors() const;
+	const std::vector<Run>& get_runs() const;
+	const std::string& get_output_path() const;
+
+	// runs are spread over the threads as an Ensemble
+	std::vector<Result> run(int threads, bool cpu_is_big_endian) const;
+	// sorts results by score, best first
+	bool write_results(std::vector<Result> results) const;
+};
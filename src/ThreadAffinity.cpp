@@ -0,0 +1,96 @@
+#include "ThreadAffinity.hpp"
+#include <vector>
+#include <fstream>
+#include <utility>
+
+#if __has_include(<omp.h>)
+	#define OMP_PRESENT
+	#include <omp.h>
+#endif
+
+#if defined(__linux__) && __has_include(<sched.h>)
+	#define AFFINITY_PRESENT
+	#include <sched.h>
+#endif
+
+namespace thread_affinity {
+	#if defined(OMP_PRESENT) && defined(AFFINITY_PRESENT)
+		namespace {
+			// -1 when the kernel doesn't say
+			int read_topology(int cpu, const char* name) {
+				std::ifstream in("/sys/devices/system/cpu/cpu" + std::to_string(cpu) + "/topology/" + name);
+				int value = -1;
+				if(!(in >> value)) return -1;
+				return value;
+			}
+
+			// the CPUs this process may run on, grouped into places in the order of their numbers
+			std::vector<cpu_set_t> find_places(const std::string& places) {
+				cpu_set_t allowed;
+				CPU_ZERO(&allowed);
+				if(sched_getaffinity(0, sizeof(allowed), &allowed) != 0) return {};
+
+				std::vector<std::pair<std::pair<int, int>, cpu_set_t>> found;
+				for(int cpu = 0; cpu < CPU_SETSIZE; ++cpu) {
+					if(!CPU_ISSET(cpu, &allowed)) continue;
+
+					// hardware threads of a core share the core and package ids
+					std::pair<int, int> id = {cpu, 0};
+					int package = read_topology(cpu, "physical_package_id");
+					int core = read_topology(cpu, "core_id");
+					if(places == "sockets" && package >= 0) id = {package, -1};
+					else if(places == "cores" && package >= 0 && core >= 0) id = {package, core};
+
+					auto place = found.begin();
+					while(place != found.end() && place->first != id) ++place;
+					if(place == found.end()) {
+						cpu_set_t set;
+						CPU_ZERO(&set);
+						found.push_back({id, set});
+						place = found.end() - 1;
+					}
+					CPU_SET(cpu, &place->second);
+				}
+
+				std::vector<cpu_set_t> res;
+				for(const auto& place : found) res.push_back(place.second);
+				return res;
+			}
+		}
+
+		std::string pin_threads(const std::string& binding, const std::string& places, int threads) {
+			if(binding.empty() || binding == "none") return "";
+			// the environment takes precedence, and OpenMP has already pinned the threads itself
+			if(omp_get_proc_bind() != omp_proc_bind_false) return "";
+
+			auto place_sets = find_places(places.empty() ? "cores" : places);
+			if(place_sets.empty()) return "Couldn't find out which CPUs the program may use; threads won't be pinned.\n";
+
+			if(threads != 0) omp_set_num_threads(threads);
+			int failed = 0;
+
+			// the same team as the simulation's later regions, so OpenMP hands them these threads again
+			#pragma omp parallel reduction(+:failed)
+			{
+				int team = omp_get_num_threads();
+				int thread = omp_get_thread_num();
+				int place_count = place_sets.size();
+
+				// like OpenMP: close fills neighbouring places, spread leaves gaps between the threads;
+				// with more threads than places both put neighbouring threads on the same place
+				int place = thread * place_count / team;
+				if(binding == "close" && team <= place_count) place = thread;
+
+				if(sched_setaffinity(0, sizeof(cpu_set_t), &place_sets[place]) != 0) ++failed;
+			}
+
+			if(failed > 0) return "Failed to pin " + std::to_string(failed) + " threads; they can run anywhere.\n";
+			return "";
+		}
+	#else
+		std::string pin_threads(const std::string& binding, const std::string&, int) {
+			if(binding.empty() || binding == "none") return "";
+			return "Thread affinity settings aren't supported on this system; threads won't be pinned.\n";
+		}
+	#endif
+}
@@ -0,0 +1,17 @@
+#pragma once
+
+#include <string>
+
+/* Pins OpenMP's threads to cores from inside the program, the way OMP_PROC_BIND and OMP_PLACES
+ * would if they had been set before it started (OpenMP reads them only once, at startup).
+ * The threads stay where they are as long as later parallel regions have the same number of threads,
+ * which is how the simulation uses them.
+ */
+
+namespace thread_affinity {
+	// `binding` is "close" or "spread", `places` "threads", "cores" or "sockets";
+	// `threads` is the team size the simulation is going to use, 0 for OpenMP's default.
+	// Does nothing when OMP_PROC_BIND is set in the environment.
+	// Returns what went wrong, empty if nothing did
+	std::string pin_threads(const std::string& binding, const std::string& places, int threads);
+}
@@ -0,0 +1,125 @@
+#include "Trace.hpp"
+#include <atomic>
+#include <array>
+#include <algorithm>
+#include <chrono>
+#include <memory>
+#include <vector>
+#include <fstream>
+#include <iomanip>
+
+namespace trace {
+	namespace {
+		struct Event {
+			const char* name;
+			std::int64_t start_ns;
+			std::int64_t duration_ns;
+		};
+
+		// when a buffer fills up the oldest events get overwritten
+		const std::size_t buffer_capacity = 1 << 16;
+		const std::size_t max_threads = 256;
+
+		// written only by its owning thread; read by finish() after all the spans have ended
+		struct ThreadBuffer {
+			std::vector<Event> events;
+			std::uint64_t written;
+
+			ThreadBuffer(): events(buffer_capacity), written(0) {}
+		};
+
+		std::atomic<bool> is_enabled(false);
+		std::string output_path;
+		std::chrono::steady_clock::time_point origin;
+
+		std::array<std::unique_ptr<ThreadBuffer>, max_threads> buffers;
+		std::atomic<std::size_t> buffer_count(0);
+
+		thread_local ThreadBuffer* local_buffer = nullptr;
+		thread_local bool local_buffer_failed = false;
+
+		std::int64_t now_ns() {
+			auto elapsed = std::chrono::steady_clock::now() - origin;
+			return std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count();
+		}
+
+		ThreadBuffer* get_local_buffer() {
+			if(local_buffer != nullptr || local_buffer_failed) return local_buffer;
+
+			std::size_t index = buffer_count.fetch_add(1);
+			if(index >= max_threads) {
+				local_buffer_failed = true;
+				return nullptr;
+			}
+
+			buffers[index] = std::make_unique<ThreadBuffer>();
+			local_buffer = buffers[index].get();
+			return local_buffer;
+		}
+
+		void write_event(std::ofstream& out, const Event& event, std::size_t thread_id) {
+			out << ",\n{\"name\":\"" << event.name << "\",\"ph\":\"X\",\"pid\":0,\"tid\":" << thread_id
+			    << ",\"ts\":" << event.start_ns / 1000.0
+			    << ",\"dur\":" << event.duration_ns / 1000.0 << "}";
+		}
+	}
+
+	void start(std::string_view path) {
+		output_path = path;
+		origin = std::chrono::steady_clock::now();
+		// the calling thread gets id 0 so it shows up first on the timeline
+		get_local_buffer();
+		is_enabled.store(true);
+	}
+
+	bool finish() {
+		if(!is_enabled.exchange(false)) return true;
+
+		std::ofstream out(output_path);
+		if(!out.good()) return false;
+
+		out << std::fixed << std::setprecision(3);
+		out << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+		out << "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":0,\"args\":{\"name\":\"SomeLife\"}}";
+
+		std::size_t thread_count = std::min(buffer_count.load(), max_threads);
+		for(std::size_t t = 0; t < thread_count; ++t) {
+			const auto* buffer = buffers[t].get();
+			if(buffer == nullptr) continue;
+
+			out << ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":0,\"tid\":" << t
+			    << ",\"args\":{\"name\":\"" << (t == 0 ? "main" : "thread " + std::to_string(t)) << "\"}}";
+
+			std::uint64_t first = 0;
+			if(buffer->written > buffer_capacity) first = buffer->written - buffer_capacity;
+
+			for(std::uint64_t i = first; i < buffer->written; ++i) {
+				write_event(out, buffer->events[i % buffer_capacity], t);
+			}
+		}
+
+		out << "\n]}\n";
+		return out.good();
+	}
+
+	bool enabled() {
+		return is_enabled.load(std::memory_order_relaxed);
+	}
+
+	Span::Span(const char* name):
+		name(name),
+		start_ns(-1)
+	{
+		if(enabled()) start_ns = now_ns();
+	}
+
+	Span::~Span() {
+		if(start_ns < 0 || !enabled()) return;
+
+		auto* buffer = get_local_buffer();
+		if(buffer == nullptr) return;
+
+		buffer->events[buffer->written % buffer_capacity] = Event { name, start_ns, now_ns() - start_ns };
+		++buffer->written;
+	}
+}
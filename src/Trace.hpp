@@ -0,0 +1,33 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <cstdint>
+
+/* Timeline tracing in the Chrome trace-event format
+ * (open the output in chrome://tracing or ui.perfetto.dev).
+ * Every thread writes its spans into its own ring buffer so recording
+ * a span is just a couple of stores; nothing is written to disk
+ * until finish() is called. When tracing wasn't started spans cost a single branch.
+ */
+
+namespace trace {
+	// starts collecting spans; they're written to `path` by finish()
+	void start(std::string_view path);
+	// writes collected spans to the file; returns false if it couldn't be written
+	bool finish();
+	bool enabled();
+
+	// `name` must outlive the trace (use string literals)
+	class Span {
+		const char* name;
+		std::int64_t start_ns;
+
+	public:
+		Span(const char* name);
+		~Span();
+
+		Span(const Span&) = delete;
+		Span& operator=(const Span&) = delete;
+	};
+}
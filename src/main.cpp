@@ -1,11 +1,24 @@
 #include <chrono>
 #include <iostream>
 #include <fstream>
+#include <algorithm>
+#include <memory>
+#include <thread>
 #include "Display.hpp"
 #include "Simulation.hpp"
 #include "Config.hpp"
 #include "ArgumentConfig.hpp"
 #include "Replayer.hpp"
+#include "Trace.hpp"
+#include "Sweep.hpp"
+#include "FrameExporter.hpp"
+#include "Publisher.hpp"
+#include "ClusterAnalysis.hpp"
+#include "FrameArena.hpp"
+#include "AllocationCounter.hpp"
+#include "FrameGovernor.hpp"
+#include "SfmlTypes.hpp"
+#include "ThreadAffinity.hpp"
 
 using namespace std::chrono;
 
@@ -15,6 +28,37 @@ bool cpu_is_big_endian() {
 	return *ptr == 0;
 }
 
+// recordings don't know the window size; don't open a window larger than the screen
+sf::Vector2i fit_to_desktop(sf::Vector2i size) {
+	auto desktop = sf::VideoMode::getDesktopMode();
+	float max_width = desktop.width * 0.9f;
+	float max_height = desktop.height * 0.9f;
+
+	float scale = std::min({1.f, max_width / size.x, max_height / size.y});
+	return sf::Vector2i(size.x * scale, size.y * scale);
+}
+
+// a line per thread to `threads_out` and a line per cell that had any pairs to `cells_out`,
+// so a whole run fits in two files
+void write_load_csv(const Simulation& simulation, std::ofstream& threads_out, std::ofstream& cells_out) {
+	auto step = simulation.get_step_count();
+	const auto& busy_ms = simulation.get_thread_busy_ms();
+	for(std::size_t thread = 0; thread < busy_ms.size(); ++thread) {
+		threads_out << step << "," << thread << "," << busy_ms[thread] << "\n";
+	}
+
+	const auto& cell_pairs = simulation.get_cell_pairs();
+	if(cell_pairs.empty()) return;
+
+	auto grid_size = simulation.get_particles().get_grid_size();
+	for(int y = 0; y < grid_size.y; ++y) {
+		for(int x = 0; x < grid_size.x; ++x) {
+			auto pairs = cell_pairs[y * grid_size.x + x];
+			if(pairs > 0) cells_out << step << "," << x << "," << y << "," << pairs << "\n";
+		}
+	}
+}
+
 bool run_simulation(const Config& config, const ArgumentConfig& arg_config, int target_fps) {
 	auto recipe = Recipe(arg_config.get_recipe_path());
 	if(!recipe.get_errors().empty()) {
@@ -23,24 +67,104 @@ bool run_simulation(const Config& config, const ArgumentConfig& arg_config, int
 		return false;
 	}
 
+	// with `--steps-per-frame auto` the simulation fills whatever is left of the frame,
+	// so the window mustn't sleep to limit the framerate on its own
+	bool adaptive_steps = arg_config.get_steps_per_frame() == 0;
+	// the governor measures drawing, which mustn't include waiting for the next frame, so it keeps the framerate itself
+	bool governed = config.get_frame_governor();
+	bool paced_here = governed && !adaptive_steps && target_fps > 0;
+	auto frame_budget = microseconds(1000000 / (target_fps > 0 ? target_fps : 60));
+
 	Simulation simulation(recipe, config.get_threads(), cpu_is_big_endian());
+	if(config.get_cell_order() == "morton") simulation.set_cell_order(ParticleGrid::CellOrder::Morton);
+	if(arg_config.get_sleep_speed() > 0) simulation.enable_sleeping(arg_config.get_sleep_speed(), arg_config.get_sleep_after());
+	if(arg_config.get_far_field() > 0) simulation.enable_far_field(arg_config.get_far_field());
 	Display display(
-			simulation.get_board_size().x,
-			simulation.get_board_size().y,
+			sfml_types::to_sf(simulation.get_window_size()),
+			sfml_types::to_sf(simulation.get_board_size()),
 			"Life?",
-			target_fps);
+			adaptive_steps || governed ? 0 : target_fps);
 
 	auto record_stream = std::ofstream();
 	if(arg_config.get_recording_state() == ArgumentConfig::RecordingState::Recording) {
 		record_stream.open(arg_config.get_recording_path().data(), std::ios::binary);
-		if(record_stream.good()) simulation.init_recording(record_stream);
+		if(record_stream.good()) simulation.init_recording(record_stream, arg_config.get_record_in_id_order());
 		else std::cout << "Failed to open file: " + std::string(arg_config.get_recording_path()) + "; cannot record the simulation.\n";
 	}
 
+	std::unique_ptr<FrameGovernor> governor;
+	if(governed) governor = std::make_unique<FrameGovernor>(target_fps, arg_config.get_steps_per_frame(), std::cout);
+
+	// room for twice the starting population, in case emitters add more
+	std::unique_ptr<Publisher> publisher;
+	if(!arg_config.get_publish_name().empty()) {
+		auto capacity = std::max<std::size_t>(simulation.get_particles().get_particles().size() * 2, 1 << 16);
+		publisher = std::make_unique<Publisher>(arg_config.get_publish_name(), simulation.get_board_size(), capacity);
+		if(!publisher->get_errors().empty()) {
+			std::cout << publisher->get_errors() << "Frames won't be published.\n";
+			publisher.reset();
+		}
+	}
+
+	std::unique_ptr<ClusterAnalysis> cluster_analysis;
+	std::ofstream cluster_summary_stream;
+	std::ofstream clusters_stream;
+	if(!arg_config.get_clusters_prefix().empty()) {
+		auto prefix = std::string(arg_config.get_clusters_prefix());
+		cluster_summary_stream.open(prefix + "_summary.csv");
+		clusters_stream.open(prefix + "_clusters.csv");
+
+		if(cluster_summary_stream.good() && clusters_stream.good()) {
+			cluster_analysis = std::make_unique<ClusterAnalysis>(recipe, arg_config.get_cluster_distance());
+			cluster_analysis->write_csv_headers(cluster_summary_stream, clusters_stream);
+		} else {
+			std::cout << "Failed to open " << prefix << "_summary.csv or " << prefix << "_clusters.csv; clusters won't be analyzed.\n";
+		}
+	}
+	std::uint64_t last_analyzed_step = 0;
+
+	std::ofstream load_threads_stream;
+	std::ofstream load_cells_stream;
+	if(!arg_config.get_load_prefix().empty()) {
+		auto threads_path = std::string(arg_config.get_load_prefix()) + "_threads.csv";
+		auto cells_path = std::string(arg_config.get_load_prefix()) + "_cells.csv";
+		load_threads_stream.open(threads_path);
+		load_cells_stream.open(cells_path);
+		if(load_threads_stream.good() && load_cells_stream.good()) {
+			load_threads_stream << "step,thread,busy_ms\n";
+			load_cells_stream << "step,x,y,pairs\n";
+		} else {
+			std::cout << "Failed to open " << threads_path << " or " << cells_path << "; load won't be exported.\n";
+			load_threads_stream.close();
+		}
+	}
+
 	auto last_frame_time = steady_clock::now();
+	auto last_output_duration = steady_clock::duration::zero();
+
+	// debug builds report heap allocations per frame; after the first few frames there shouldn't be any
+	std::uint64_t frames_counted = 0;
+	std::uint64_t allocations_counted = 0;
+	auto allocations_reported = steady_clock::now();
+	auto sleep_reported = steady_clock::now();
 
 	while(display.window_is_open()) {
-		display.handle_events();
+		auto allocations_before = allocation_counter::count();
+		trace::Span frame_span("frame");
+		auto frame_start = steady_clock::now();
+
+		auto phase_start = frame_start;
+		auto end_phase = [&](FrameGovernor::Phase phase) {
+			auto now = steady_clock::now();
+			if(governor) governor->add_time(phase, now - phase_start);
+			phase_start = now;
+		};
+
+		{
+			trace::Span events_span("handle events");
+			display.handle_events();
+		}
+		end_phase(FrameGovernor::Phase::Events);
 
 		auto current_frame_time = steady_clock::now();
 		auto delta_time = current_frame_time - last_frame_time;
@@ -50,9 +174,78 @@ bool run_simulation(const Config& config, const ArgumentConfig& arg_config, int
 		int delta_us = duration_cast<microseconds>(delta_time).count();
 		if(delta_us != 0) framerate = 1000000 / delta_us;
 
-		simulation.update();
-		if(record_stream.is_open() && record_stream.good()) simulation.record(record_stream);
-		display.draw_window(simulation.get_particles(), framerate);
+		// only counted while someone looks at it
+		bool load_exported = load_threads_stream.is_open() && load_threads_stream.good();
+		simulation.enable_load_tracking(display.load_overlay_shown() || load_exported);
+
+		int steps;
+		if(adaptive_steps) {
+			auto other_work = (steady_clock::now() - frame_start) + last_output_duration;
+			steps = simulation.update_for(frame_budget - other_work);
+		} else {
+			steps = governor ? governor->get_steps_per_frame() : arg_config.get_steps_per_frame();
+			simulation.update(steps);
+		}
+		end_phase(FrameGovernor::Phase::Update);
+
+		// only the state after the last step of the frame is recorded and drawn
+		auto output_start = steady_clock::now();
+
+		// with many steps per frame this happens on the first frame that gets past every K-th step
+		auto interval = static_cast<std::uint64_t>(arg_config.get_cluster_interval());
+		if(cluster_analysis && simulation.get_step_count() / interval != last_analyzed_step / interval) {
+			cluster_analysis->analyze(simulation.get_particles());
+			cluster_analysis->write_csv(simulation.get_step_count(), cluster_summary_stream, clusters_stream);
+			last_analyzed_step = simulation.get_step_count();
+		}
+
+		if(load_exported) write_load_csv(simulation, load_threads_stream, load_cells_stream);
+		if(display.load_overlay_shown()) display.set_load(simulation.get_cell_pairs(), simulation.get_thread_busy_ms());
+
+		if(publisher) {
+			trace::Span publish_span("publish");
+			publisher->publish(simulation.get_particles().get_particles());
+		}
+		end_phase(FrameGovernor::Phase::Other);
+
+		if(record_stream.is_open() && record_stream.good()) {
+			trace::Span record_span("record");
+			simulation.record(record_stream);
+		}
+		end_phase(FrameGovernor::Phase::Record);
+
+		{
+			trace::Span draw_span("draw window");
+			if(governor) display.set_detail(governor->get_detail());
+			display.draw_window(simulation.get_particles(), framerate);
+		}
+		end_phase(FrameGovernor::Phase::Draw);
+
+		last_output_duration = steady_clock::now() - output_start;
+		if(governor) governor->end_frame(steps);
+		frame_arena::reset_local();
+
+		if(allocation_counter::enabled()) {
+			allocations_counted += allocation_counter::count() - allocations_before;
+			++frames_counted;
+
+			if(steady_clock::now() - allocations_reported > seconds(5)) {
+				std::cout << "heap allocations per frame: " << static_cast<double>(allocations_counted) / frames_counted << "\n";
+				allocations_counted = 0;
+				frames_counted = 0;
+				allocations_reported = steady_clock::now();
+			}
+		}
+
+		if(arg_config.get_sleep_speed() > 0 && steady_clock::now() - sleep_reported > seconds(5)) {
+			const auto& stats = simulation.get_sleep_stats();
+			std::cout << "asleep: " << static_cast<int>(stats.asleep_fraction * 100) << "% of cells, "
+			          << stats.asleep_particles << " particles; skipped motion "
+			          << stats.skipped_motion << " per step (at most " << arg_config.get_sleep_speed() << " per particle)\n";
+			sleep_reported = steady_clock::now();
+		}
+
+		if(paced_here) std::this_thread::sleep_until(frame_start + frame_budget);
 	}
 
 	return true;
@@ -66,15 +259,20 @@ bool run_replay(ArgumentConfig arg_config, int target_fps) {
 	}
 
 	Display display(
-			replayer.get_board_size().x,
-			replayer.get_board_size().y,
+			fit_to_desktop(sfml_types::to_sf(replayer.get_board_size())),
+			sfml_types::to_sf(replayer.get_board_size()),
 			"Life?",
 			target_fps);
 
 	auto last_frame_time = std::chrono::steady_clock::now();
 
 	while(display.window_is_open()) {
-		display.handle_events();
+		trace::Span frame_span("frame");
+
+		{
+			trace::Span events_span("handle events");
+			display.handle_events();
+		}
 
 		auto current_frame_time = steady_clock::now();
 		auto delta_time = current_frame_time - last_frame_time;
@@ -84,13 +282,56 @@ bool run_replay(ArgumentConfig arg_config, int target_fps) {
 		int delta_us = duration_cast<microseconds>(delta_time).count();
 		if(delta_us != 0) framerate = 1000000 / delta_us;
 
-		replayer.next_frame();
+		{
+			trace::Span replay_span("next frame");
+			replayer.next_frame();
+		}
+
+		trace::Span draw_span("draw window");
 		display.draw_window(replayer.get_particles(), framerate);
 	}
 
 	return true;
 }
 
+bool run_export(const Config& config, const ArgumentConfig& arg_config) {
+	auto format = arg_config.get_export_raw() ? FrameExporter::Raw : FrameExporter::Png;
+	FrameExporter exporter(arg_config.get_recording_path(), arg_config.get_export_path(), format, cpu_is_big_endian());
+
+	// raw frames can go to stdout, so everything else goes to stderr then
+	std::ostream& log = exporter.writes_to_stdout() ? std::cerr : std::cout;
+
+	int frames = exporter.run(config.get_threads());
+	if(!exporter.get_errors().empty()) {
+		log << exporter.get_errors();
+		return false;
+	}
+
+	auto size = exporter.get_image_size();
+	log << "Exported " << frames << " frames of " << size.x << "x" << size.y << "\n";
+	return true;
+}
+
+bool run_sweep(const Config& config, const ArgumentConfig& arg_config) {
+	Sweep sweep(arg_config.get_sweep_path());
+	if(!sweep.get_errors().empty()) {
+		std::cout << "Error loading sweep \"" << arg_config.get_sweep_path() << "\":\n";
+		std::cout << sweep.get_errors();
+		return false;
+	}
+
+	std::cout << "Running " << sweep.get_runs().size() << " simulations\n";
+	auto results = sweep.run(config.get_threads(), cpu_is_big_endian());
+
+	if(!sweep.write_results(results)) {
+		std::cout << "Failed to write results: " << sweep.get_output_path() << "\n";
+		return false;
+	}
+
+	std::cout << "Results written to " << sweep.get_output_path() << "\n";
+	return true;
+}
+
 int main(int argc, const char* argv[]) {
 	ArgumentConfig arg_config(argc, argv);
 	if(!arg_config.get_errors().empty()) {
@@ -99,27 +340,49 @@ int main(int argc, const char* argv[]) {
 		exit(1);
 	}
 
+	// raw exported frames can take up the standard output
+	bool stdout_taken = arg_config.get_export_raw() && arg_config.get_export_path() == "-";
+	std::ostream& log = stdout_taken ? std::cerr : std::cout;
+
 	Config config("res/somelife.conf");
 	if(!config.get_errors().empty()) {
-		std::cout << "Problems reading config:\n";
-		std::cout << config.get_errors() << "\n";
-		std::cout << "Config in use:\n";
-		std::cout << "target_fps=" << config.get_target_fps() << "\n";
-		std::cout << "threads=" << config.get_threads() << "\n\n";
+		log << "Problems reading config:\n";
+		log << config.get_errors() << "\n";
+		log << "Config in use:\n";
+		log << "target_fps=" << config.get_target_fps() << "\n";
+		log << "threads=" << config.get_threads() << "\n";
+		log << "thread_binding=" << (config.get_thread_binding().empty() ? "none" : config.get_thread_binding()) << "\n";
+		log << "thread_places=" << (config.get_thread_places().empty() ? "cores" : config.get_thread_places()) << "\n";
+		log << "huge_pages=" << config.get_huge_pages() << "\n\n";
 	}
 
+	log << thread_affinity::pin_threads(config.get_thread_binding(), config.get_thread_places(), config.get_threads());
+
+	if(config.get_huge_pages() == "transparent") particle_memory::set_huge_pages(particle_memory::HugePages::Transparent);
+	else if(config.get_huge_pages() == "explicit") particle_memory::set_huge_pages(particle_memory::HugePages::Explicit);
+
 	int target_fps;
 	if(arg_config.get_framerate() > 0) target_fps = arg_config.get_framerate();
 	else target_fps = config.get_target_fps();
 
+	if(!arg_config.get_trace_path().empty()) trace::start(arg_config.get_trace_path());
+
 	bool success = true;
 
-	if(arg_config.get_recording_state() == ArgumentConfig::RecordingState::Replaying) {
+	if(!arg_config.get_sweep_path().empty()) {
+		success = run_sweep(config, arg_config);
+	} else if(!arg_config.get_export_path().empty()) {
+		success = run_export(config, arg_config);
+	} else if(arg_config.get_recording_state() == ArgumentConfig::RecordingState::Replaying) {
 		success = run_replay(arg_config, target_fps);
 	} else {
 		success = run_simulation(config, arg_config, target_fps);
 	}
 
+	if(!trace::finish()) {
+		std::cout << "Failed to write trace: " << arg_config.get_trace_path() << "\n";
+	}
+
 	if(success) return EXIT_SUCCESS;
 	return EXIT_FAILURE;
 }
@@ -0,0 +1,132 @@
+/* Minimal reader of the frames published with `somelife --publish name`.
+ * Follows the newest frame for a while, computing the center of mass of every frame
+ * right in the shared memory, then prints how many frames it got and how fast.
+ * Doubles as a throughput test of the publisher: run it next to a simulation with
+ * `--steps-per-frame auto` or a high `--framerate`.
+ *
+ * Usage: somelife_publish_reader name [seconds]
+ */
+
+#include <chrono>
+#include <thread>
+#include <string>
+#include <algorithm>
+#include <iostream>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "PublishLayout.hpp"
+
+using namespace std::chrono;
+
+namespace {
+	struct Stats {
+		std::uint64_t frames_read = 0;
+		// published while we were busy with other frames
+		std::uint64_t frames_skipped = 0;
+		// frames overwritten while being read
+		std::uint64_t retries = 0;
+		std::uint64_t particles_read = 0;
+	};
+
+	// reads the frame in the slot of `latest_frame` in place; false if it was overwritten meanwhile
+	bool read_frame(publishing::Header* header, std::uint64_t latest_frame, float& center_x, float& center_y, std::uint32_t& count) {
+		auto* slot = publishing::slot_at(header, (latest_frame - 1) % header->slot_count);
+
+		auto sequence = slot->sequence.load(std::memory_order_acquire);
+		if(sequence % 2 == 1) return false;
+
+		count = std::min(slot->particle_count, header->slot_capacity);
+		const auto* particles = publishing::particles_of(slot);
+		double sum_x = 0, sum_y = 0;
+		for(std::uint32_t i=0; i<count; ++i) {
+			sum_x += particles[i].x;
+			sum_y += particles[i].y;
+		}
+		bool right_frame = slot->frame == latest_frame - 1;
+
+		std::atomic_thread_fence(std::memory_order_acquire);
+		if(slot->sequence.load(std::memory_order_relaxed) != sequence || !right_frame) return false;
+
+		center_x = count > 0 ? sum_x / count : 0;
+		center_y = count > 0 ? sum_y / count : 0;
+		return true;
+	}
+}
+
+int main(int argc, const char* argv[]) {
+	if(argc < 2 || argc > 3) {
+		std::cerr << "Usage: " << argv[0] << " name [seconds]\n";
+		return EXIT_FAILURE;
+	}
+
+	std::string name = argv[1];
+	if(name[0] != '/') name = "/" + name;
+	double seconds = argc == 3 ? std::stod(argv[2]) : 10;
+
+	int fd = shm_open(name.c_str(), O_RDONLY, 0);
+	if(fd < 0) {
+		std::cerr << "Can't open shared memory: " << name << " (is the simulation running?)\n";
+		return EXIT_FAILURE;
+	}
+
+	struct stat info;
+	fstat(fd, &info);
+	// read only is enough, the seqlock is only ever loaded from
+	void* memory = mmap(nullptr, info.st_size, PROT_READ, MAP_SHARED, fd, 0);
+	close(fd);
+	if(memory == MAP_FAILED || static_cast<std::size_t>(info.st_size) < sizeof(publishing::Header)) {
+		std::cerr << "Can't map shared memory: " << name << "\n";
+		return EXIT_FAILURE;
+	}
+
+	auto* header = static_cast<publishing::Header*>(memory);
+	if(header->magic != publishing::magic) {
+		std::cerr << name << " isn't a SomeLife frame publisher\n";
+		return EXIT_FAILURE;
+	}
+	std::atomic_thread_fence(std::memory_order_acquire);
+
+	std::cout << "board " << header->board_width << "x" << header->board_height
+	          << ", " << header->slot_count << " slots of " << header->slot_capacity << " particles\n";
+
+	Stats stats;
+	std::uint64_t last_frame = header->latest_frame.load(std::memory_order_acquire);
+	float center_x = 0, center_y = 0;
+
+	auto start = steady_clock::now();
+	auto end = start + duration<double>(seconds);
+
+	while(steady_clock::now() < end) {
+		auto latest_frame = header->latest_frame.load(std::memory_order_acquire);
+		if(latest_frame == last_frame) {
+			std::this_thread::yield();
+			continue;
+		}
+
+		std::uint32_t count;
+		if(!read_frame(header, latest_frame, center_x, center_y, count)) {
+			++stats.retries;
+			continue;
+		}
+
+		if(last_frame != 0) stats.frames_skipped += latest_frame - last_frame - 1;
+		last_frame = latest_frame;
+		++stats.frames_read;
+		stats.particles_read += count;
+	}
+
+	double elapsed = duration<double>(steady_clock::now() - start).count();
+	double megabytes = stats.particles_read * sizeof(publishing::Particle) / 1e6;
+
+	std::cout << "frames read: " << stats.frames_read << " (" << stats.frames_read / elapsed << " per second)\n";
+	std::cout << "frames skipped: " << stats.frames_skipped << "\n";
+	std::cout << "torn reads retried: " << stats.retries << "\n";
+	std::cout << "particle data read: " << megabytes / elapsed << " MB/s\n";
+	std::cout << "last center of mass: " << center_x << ", " << center_y << "\n";
+
+	munmap(memory, info.st_size);
+	return EXIT_SUCCESS;
+}